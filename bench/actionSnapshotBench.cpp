@@ -0,0 +1,119 @@
+#include <Urho3D/Input/Input.h>
+
+#include "config.h"
+
+#include "benchCommon.h"
+
+#include <map>
+#include <unordered_map>
+
+/**
+ * GetActionKeyInput() against the lookup it replaced. Every frame one bound key changes state,
+ * then every action is queried from gameplay code.
+ */
+
+/// Frame of the previous GetActionKeyInput(): subsystem lookup, hash map find, Input polled per binding.
+class PollingActionInput
+{
+public:
+	explicit PollingActionInput(Configuration* config)
+		: config_(config)
+	{
+		for (U32 action = 0; action < Configuration::ACTIONS_COUNT; action++)
+		{
+			for (U32 unitNumber = 0; unitNumber < Configuration::ACTION_UNITS_PER_ACTION; unitNumber++)
+			{
+				Configuration::ActionUnit unit = config->GetActionUnit(static_cast<Configuration::GameInputActions>(action), unitNumber);
+				if (unit.deviceType_ != Configuration::InputDeviceType::No_Device)
+					userActionMap_[action][unitNumber] = unit;
+			}
+		}
+	}
+
+	bool GetActionKeyInput(Configuration::GameInputActions action) const
+	{
+		Input* input = config_->GetSubsystem<Input>();
+		if (!input)
+			return false;
+
+		auto userActionIt = userActionMap_.find(static_cast<U32>(action));
+		if (userActionIt == userActionMap_.end())
+			return false;
+
+		bool keyInputWorked = false;
+		for (auto& userActionUnit : userActionIt->second)
+		{
+			if (userActionUnit.second.deviceType_ == Configuration::InputDeviceType::Keyboard)
+				keyInputWorked = keyInputWorked || input->GetKeyDown(userActionUnit.second.key_);
+			else if (userActionUnit.second.deviceType_ == Configuration::InputDeviceType::Mouse)
+				keyInputWorked = keyInputWorked || input->GetMouseButtonDown(userActionUnit.second.key_);
+		}
+
+		return keyInputWorked;
+	}
+
+private:
+	Configuration* config_;
+	std::unordered_map<U32, std::map<U32, Configuration::ActionUnit> > userActionMap_;
+};
+
+static const U32 SAMPLES = 2000;
+/// gameplay queries every action a few times per frame
+static const U32 QUERIES_PER_FRAME = Configuration::ACTIONS_COUNT * 4;
+
+int main(int argc, char** argv)
+{
+	SharedPtr<Context> context(new Context());
+	SharedPtr<Engine> engine = CreateHeadlessEngine(context);
+	if (!engine)
+		return 1;
+
+	Configuration* config = new Configuration(context);
+	context->RegisterSubsystem(config);
+	config->Load();
+
+	SharedPtr<ScriptedInput> input(new ScriptedInput(context));
+	PollingActionInput polling(config);
+
+	// headless Input never sees the scripted keys, so polling reads the key state
+	// tables of an idle Input. That is the lookup cost, not a comparison of results
+	U32 frame = 0;
+	auto nextFrame = [&]()
+	{
+		U32 action = frame % Configuration::ACTIONS_COUNT;
+		Configuration::ActionUnit unit = config->GetActionUnit(static_cast<Configuration::GameInputActions>(action), 0);
+		bool press = (frame / Configuration::ACTIONS_COUNT) % 2 == 0;
+		if (unit.deviceType_ == Configuration::InputDeviceType::Keyboard)
+			press ? input->PressKey(unit.key_) : input->ReleaseKey(unit.key_);
+		else if (unit.deviceType_ == Configuration::InputDeviceType::Mouse)
+			press ? input->PressMouseButton(unit.key_) : input->ReleaseMouseButton(unit.key_);
+
+		input->RunFrame();
+		frame++;
+	};
+
+	PrintResult(RunBench("action_query_snapshot", SAMPLES, QUERIES_PER_FRAME, nextFrame, [&](U32 i)
+	{
+		KeepResult(config->GetActionKeyInput(static_cast<Configuration::GameInputActions>(i % Configuration::ACTIONS_COUNT)));
+	}));
+
+	PrintResult(RunBench("action_query_polling", SAMPLES, QUERIES_PER_FRAME, nextFrame, [&](U32 i)
+	{
+		KeepResult(polling.GetActionKeyInput(static_cast<Configuration::GameInputActions>(i % Configuration::ACTIONS_COUNT)));
+	}));
+
+	// what the snapshot costs per frame: key events routed through the action index and E_INPUTEND
+	U32 transition = 0;
+	PrintResult(RunBench("action_snapshot_frame", SAMPLES, 1, [&]()
+	{
+		Configuration::ActionUnit unit = config->GetActionUnit(static_cast<Configuration::GameInputActions>(transition % Configuration::ACTIONS_COUNT), 0);
+		if (unit.deviceType_ == Configuration::InputDeviceType::Keyboard)
+			(transition / Configuration::ACTIONS_COUNT) % 2 ? input->ReleaseKey(unit.key_) : input->PressKey(unit.key_);
+		transition++;
+	}, [&](U32 i)
+	{
+		input->SendInput();
+	}));
+
+	return 0;
+}
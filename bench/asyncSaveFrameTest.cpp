@@ -0,0 +1,145 @@
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+
+#include "config.h"
+
+#include "benchCommon.h"
+
+#include <cstring>
+
+/**
+ * Frame time while settings are saved. Every round changes a parameter and calls Save(), as the
+ * Apply buttons of the menus do, then runs frames until the coalesced save was written in the
+ * background. The synchronous baseline is Save() followed by Flush() inside one frame.
+ *
+ * With --budget-us N the test fails when the slowest frame of more than one round in ten exceeds
+ * N microseconds. It also fails when the last value does not reach the file without Flush().
+ */
+
+static const U32 SAVE_ROUNDS = 20;
+/// frames keep running this long after Save(), the write is dispatched after SAVE_COALESCE_MSEC
+static const U32 ROUND_MSEC = Configuration::SAVE_COALESCE_MSEC + 250;
+/// sleep between frames, roughly a frame at 250 fps
+static const U32 FRAME_SLEEP_MSEC = 4;
+
+static F32 RoundVolume(U32 round)
+{
+	return round % 2 ? 0.25f : 0.5f;
+}
+
+/// Volume stored in the config file, or -1 when it cannot be read.
+static F32 ReadStoredVolume(Context* context, const String& fileName)
+{
+	File configFile(context, fileName, FILE_READ);
+	if (!configFile.IsOpen())
+		return -1.0f;
+
+	PODVector<char> content(configFile.GetSize() + 1);
+	content[configFile.Read(&content[0], configFile.GetSize())] = '\0';
+
+	Configuration::ParsedConfig parsed;
+	parsed.values_.sound_ = -1.0f;
+	if (!Configuration::ParseConfig(&content[0], nullptr, parsed))
+		return -1.0f;
+
+	return parsed.values_.sound_;
+}
+
+int main(int argc, char** argv)
+{
+	long long budgetNSec = 0;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "--budget-us"))
+			budgetNSec = std::atoll(argv[i + 1]) * 1000;
+	}
+
+	SharedPtr<Context> context(new Context());
+	SharedPtr<Engine> engine = CreateHeadlessEngine(context);
+	if (!engine)
+		return 1;
+
+	Configuration* config = new Configuration(context);
+	context->RegisterSubsystem(config);
+	config->Load();
+	config->Flush();
+
+	SharedPtr<ScriptedInput> input(new ScriptedInput(context));
+
+	std::vector<double> idleFrames;
+	std::vector<double> saveFrames;
+	std::vector<double> worstSaveFrames;
+	unsigned long long idleAllocations = 0;
+	unsigned long long saveAllocations = 0;
+
+	auto runFrames = [&](U32 msec, std::vector<double>& frames, unsigned long long& allocations) -> double
+	{
+		double worst = 0.0;
+		Timer roundTimer;
+		while (roundTimer.GetMSec(false) < msec)
+		{
+			unsigned long long allocationsBefore = benchAllocations.load(std::memory_order_relaxed);
+			long long start = BenchNowNSec();
+			input->RunFrame();
+			double elapsed = static_cast<double>(BenchNowNSec() - start);
+			allocations += benchAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+			frames.push_back(elapsed);
+			worst = std::max(worst, elapsed);
+			Time::Sleep(FRAME_SLEEP_MSEC);
+		}
+		return worst;
+	};
+
+	runFrames(ROUND_MSEC, idleFrames, idleAllocations);
+
+	// allocations include the save worker's, which runs while the frames are counted
+	for (U32 round = 0; round < SAVE_ROUNDS; round++)
+	{
+		config->Set(ConfigKeys::Sound, RoundVolume(round));
+		config->Save();
+		worstSaveFrames.push_back(runFrames(ROUND_MSEC, saveFrames, saveAllocations));
+	}
+
+	FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+#ifdef _DEBUG
+	String configFileName = fileSystem->GetProgramDir() + "config_d.json";
+#else
+	String configFileName = fileSystem->GetProgramDir() + "config.json";
+#endif // _DEBUG
+	bool written = ReadStoredVolume(context, configFileName) == RoundVolume(SAVE_ROUNDS - 1);
+
+	std::vector<double> syncSaves;
+	unsigned long long syncAllocations = 0;
+	for (U32 round = 0; round < SAVE_ROUNDS; round++)
+	{
+		config->Set(ConfigKeys::Sound, RoundVolume(round));
+
+		unsigned long long allocationsBefore = benchAllocations.load(std::memory_order_relaxed);
+		long long start = BenchNowNSec();
+		config->Save();
+		config->Flush();
+		syncSaves.push_back(static_cast<double>(BenchNowNSec() - start));
+		syncAllocations += benchAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+	}
+
+	PrintResult(SummarizeSamples("save_frame_idle", idleFrames, 1, idleAllocations));
+	PrintResult(SummarizeSamples("save_frame_async", saveFrames, 1, saveAllocations));
+	BenchResult worst = SummarizeSamples("save_frame_async_worst", worstSaveFrames, 1, 0);
+	PrintResult(worst);
+	PrintResult(SummarizeSamples("save_flush_sync", syncSaves, 1, syncAllocations));
+
+	if (!written)
+	{
+		std::fprintf(stderr, "Save() did not reach %s without Flush()\n", configFileName.CString());
+		return 1;
+	}
+
+	if (budgetNSec && worst.p90_ > budgetNSec)
+	{
+		std::fprintf(stderr, "Slowest frames of save rounds reach %.1f us, budget is %lld us\n", worst.p90_ / 1000.0, budgetNSec / 1000);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Input/InputEvents.h>
+
+#include "utility/simpleTypes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace Urho3D;
+
+/**
+ * Shared by the standalone benchmarks in this directory. Each benchmark is a single translation unit with
+ * its own main(), linked against Urho3D and the game sources it measures. This header replaces the global
+ * operator new to count allocations, so only that one unit may include it.
+ *
+ * Results go to stdout, one JSON object per line:
+ * {"bench":"name","ops":n,"ns_per_op":x,"allocs_per_op":x,"p50_ns":x,"p90_ns":x,"p99_ns":x}
+ * Percentiles are over samples, a sample is the mean of one batch of operations.
+ *
+ * Configuration reads and writes config.json next to the executable, run the benchmarks from a scratch
+ * copy of the bin directory.
+ */
+
+/// heap allocations since start, from any thread
+static std::atomic<unsigned long long> benchAllocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+	benchAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+/// Cost of one benchmark, times in nanoseconds.
+struct BenchResult
+{
+	const char* name_        = "";
+	U32         ops_         = 0;
+	double      nsPerOp_     = 0.0;
+	double      allocsPerOp_ = 0.0;
+	double      p50_         = 0.0;
+	double      p90_         = 0.0;
+	double      p99_         = 0.0;
+};
+
+/// Results are written here so the measured calls are not optimized away.
+static volatile U32 benchSink = 0;
+
+inline void KeepResult(U32 value)
+{
+	benchSink = benchSink + value;
+}
+
+inline long long BenchNowNSec()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Nearest-rank percentile of sorted samples.
+inline double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.5);
+	return sorted[std::min(rank ? rank - 1 : 0, sorted.size() - 1)];
+}
+
+/// Result of samples of opsPerSample operations each, sampleNSec holds the mean time per operation of every sample.
+inline BenchResult SummarizeSamples(const char* name, std::vector<double> sampleNSec, U32 opsPerSample, unsigned long long allocations)
+{
+	BenchResult result;
+	result.name_ = name;
+	result.ops_ = static_cast<U32>(sampleNSec.size()) * opsPerSample;
+	if (sampleNSec.empty())
+		return result;
+
+	double sum = 0.0;
+	for (double sample : sampleNSec)
+		sum += sample;
+
+	std::sort(sampleNSec.begin(), sampleNSec.end());
+	result.nsPerOp_ = sum / sampleNSec.size();
+	result.allocsPerOp_ = result.ops_ ? static_cast<double>(allocations) / result.ops_ : 0.0;
+	result.p50_ = Percentile(sampleNSec, 0.50);
+	result.p90_ = Percentile(sampleNSec, 0.90);
+	result.p99_ = Percentile(sampleNSec, 0.99);
+	return result;
+}
+
+/**
+ * Run samples batches of opsPerSample calls of op(index). setup() runs before every batch and is
+ * neither timed nor counted, e.g. to build the object a batch of one operation consumes.
+ */
+template <class Setup, class Op>
+BenchResult RunBench(const char* name, U32 samples, U32 opsPerSample, Setup setup, Op op)
+{
+	std::vector<double> sampleNSec;
+	sampleNSec.reserve(samples);
+
+	unsigned long long allocations = 0;
+	for (U32 sample = 0; sample < samples; sample++)
+	{
+		setup();
+
+		unsigned long long allocationsBefore = benchAllocations.load(std::memory_order_relaxed);
+		long long start = BenchNowNSec();
+		for (U32 i = 0; i < opsPerSample; i++)
+			op(i);
+		long long elapsed = BenchNowNSec() - start;
+		allocations += benchAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+		sampleNSec.push_back(static_cast<double>(elapsed) / opsPerSample);
+	}
+
+	return SummarizeSamples(name, sampleNSec, opsPerSample, allocations);
+}
+
+template <class Op>
+BenchResult RunBench(const char* name, U32 samples, U32 opsPerSample, Op op)
+{
+	return RunBench(name, samples, opsPerSample, [] { }, op);
+}
+
+inline void PrintResult(const BenchResult& result)
+{
+	std::printf("{\"bench\":\"%s\",\"ops\":%u,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f}\n",
+		result.name_, result.ops_, result.nsPerOp_, result.allocsPerOp_, result.p50_, result.p90_, result.p99_);
+	std::fflush(stdout);
+}
+
+/// Benchmarks that cannot run in this setup are listed, so a missing line is never mistaken for a pass.
+inline void PrintSkipped(const char* name, const char* reason)
+{
+	std::printf("{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", name, reason);
+	std::fflush(stdout);
+}
+
+/// Engine without window, sound or log output. Null when initialization failed.
+inline SharedPtr<Engine> CreateHeadlessEngine(Context* context)
+{
+	SharedPtr<Engine> engine(new Engine(context));
+
+	VariantMap engineParameters;
+	engineParameters[EP_HEADLESS] = true;
+	engineParameters[EP_LOG_NAME] = "";
+	engineParameters[EP_LOG_QUIET] = true;
+	engineParameters[EP_RESOURCE_PATHS] = "Data;CoreData";
+	engineParameters[EP_WORKER_THREADS] = true;
+	if (!engine->Initialize(engineParameters))
+		return SharedPtr<Engine>();
+
+	return engine;
+}
+
+/**
+ * Stands in for Input, which only reads SDL events once a window is open. Key and mouse button
+ * transitions are queued and sent in the order Input::Update() sends them, followed by E_INPUTEND.
+ */
+class ScriptedInput : public Object
+{
+	URHO3D_OBJECT(ScriptedInput, Object);
+
+public:
+	explicit ScriptedInput(Context* context) : Object(context) { }
+
+	void PressKey(S32 key) { Queue(E_KEYDOWN, key); }
+	void ReleaseKey(S32 key) { Queue(E_KEYUP, key); }
+	void PressMouseButton(S32 button) { Queue(E_MOUSEBUTTONDOWN, button); }
+	void ReleaseMouseButton(S32 button) { Queue(E_MOUSEBUTTONUP, button); }
+
+	/// Send the queued transitions and E_INPUTEND.
+	void SendInput()
+	{
+		for (const Transition& transition : transitions_)
+		{
+			VariantMap& eventData = GetEventDataMap();
+			if (transition.eventType_ == E_KEYDOWN || transition.eventType_ == E_KEYUP)
+			{
+				using namespace KeyDown;
+				eventData[P_KEY] = transition.key_;
+				eventData[P_SCANCODE] = 0;
+				eventData[P_BUTTONS] = 0;
+				eventData[P_QUALIFIERS] = 0;
+				eventData[P_REPEAT] = false;
+			}
+			else
+			{
+				using namespace MouseButtonDown;
+				eventData[P_BUTTON] = transition.key_;
+				eventData[P_BUTTONS] = 0;
+				eventData[P_QUALIFIERS] = 0;
+			}
+			SendEvent(transition.eventType_, eventData);
+		}
+		transitions_.Clear();
+
+		SendEvent(E_INPUTEND);
+	}
+
+	/// One frame in Engine order: E_BEGINFRAME, the input of the frame, E_ENDFRAME.
+	void RunFrame(F32 timeStep = 1.0f / 60.0f)
+	{
+		Time* time = GetSubsystem<Time>();
+		time->BeginFrame(timeStep);
+		SendInput();
+		time->EndFrame();
+	}
+
+private:
+	struct Transition
+	{
+		StringHash eventType_;
+		S32        key_;
+	};
+
+	void Queue(StringHash eventType, S32 key)
+	{
+		Transition transition;
+		transition.eventType_ = eventType;
+		transition.key_ = key;
+		transitions_.Push(transition);
+	}
+
+	PODVector<Transition> transitions_;
+};
@@ -0,0 +1,189 @@
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+
+#include "config.h"
+#include "mainMenu/menuControlsPropertiesState.h"
+
+#include "benchCommon.h"
+
+#include <cstring>
+
+/**
+ * Regression suite for Configuration and the menu states on a headless engine. Every result is one
+ * JSON line, see benchCommon.h. Results ending in _keysN ran against a config file with N keys outside
+ * the schema on top of a complete file. Such keys keep the JSON DOM alive and bypass the binary cache,
+ * so they are the part of a config that can grow.
+ *
+ * --quick runs a tenth of the samples, for a smoke test.
+ */
+
+static const U32 SAMPLES = 500;
+static const U32 QUERIES_PER_SAMPLE = 256;
+static const U32 UNKNOWN_KEY_COUNTS[] = { 0, 64, 1024, 8192 };
+
+/// Complete config as Configuration writes it, plus unknownKeys keys outside the schema, every fourth an object.
+static String BuildSyntheticConfig(const String& savedConfig, U32 unknownKeys)
+{
+	String json = savedConfig;
+	U32 end = json.Length();
+	while (end && json[end - 1] != '}')
+		end--;
+	if (!end || !unknownKeys)
+		return json;
+
+	json.Resize(end - 1);
+	for (U32 key = 0; key < unknownKeys; key++)
+	{
+		if (key % 4 == 3)
+			json.AppendWithFormat(",\n\t\"benchObject%u\": { \"enabled\": true, \"weight\": %u.5, \"tag\": \"item %u\" }", key, key, key);
+		else
+			json.AppendWithFormat(",\n\t\"benchValue%u\": \"synthetic value %u\"", key, key);
+	}
+	json += "\n}\n";
+	return json;
+}
+
+static bool WriteText(Context* context, const String& fileName, const String& text)
+{
+	File file(context, fileName, FILE_WRITE);
+	return file.IsOpen() && file.Write(text.CString(), text.Length()) == text.Length();
+}
+
+static String ReadText(Context* context, const String& fileName)
+{
+	File file(context, fileName, FILE_READ);
+	if (!file.IsOpen())
+		return String::EMPTY;
+
+	String text;
+	text.Resize(file.GetSize());
+	if (file.GetSize())
+		file.Read(&text[0], file.GetSize());
+	return text;
+}
+
+int main(int argc, char** argv)
+{
+	U32 samples = SAMPLES;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "--quick"))
+			samples = SAMPLES / 10;
+	}
+
+	SharedPtr<Context> context(new Context());
+	SharedPtr<Engine> engine = CreateHeadlessEngine(context);
+	if (!engine)
+		return 1;
+
+	FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+#ifdef _DEBUG
+	String configFileName = fileSystem->GetProgramDir() + "config_d.json";
+#else
+	String configFileName = fileSystem->GetProgramDir() + "config.json";
+#endif // _DEBUG
+	String cacheFileName = configFileName + ".cache";
+
+	Configuration* config = new Configuration(context);
+	context->RegisterSubsystem(config);
+	Input* input = context->GetSubsystem<Input>();
+
+	// a complete file is the base every synthetic config grows from
+	config->Load();
+	config->Flush();
+	String savedConfig = ReadText(context, configFileName);
+	if (savedConfig.Empty())
+	{
+		std::fprintf(stderr, "Could not read %s\n", configFileName.CString());
+		return 1;
+	}
+
+	// result names must outlive the results
+	Vector<String> names;
+	names.Reserve(sizeof(UNKNOWN_KEY_COUNTS) / sizeof(UNKNOWN_KEY_COUNTS[0]) * 3);
+	auto sizedName = [&](const char* name, U32 unknownKeys) -> const char*
+	{
+		names.Push(String(name) + "_keys" + String(unknownKeys));
+		return names.Back().CString();
+	};
+
+	for (U32 unknownKeys : UNKNOWN_KEY_COUNTS)
+	{
+		String json = BuildSyntheticConfig(savedConfig, unknownKeys);
+		// larger files get fewer samples, the total time stays in the same range
+		U32 sizeSamples = Max(samples * 64 / Max(unknownKeys, 64u), 10u);
+
+		PrintResult(RunBench(sizedName("config_parse", unknownKeys), sizeSamples, 1, [&](U32 i)
+		{
+			Configuration::ParsedConfig parsed;
+			KeepResult(Configuration::ParseConfig(json.CString(), input, parsed));
+		}));
+
+		// the JSON path, a cache left by an earlier size must not be taken
+		WriteText(context, configFileName, json);
+		PrintResult(RunBench(sizedName("config_load", unknownKeys), sizeSamples, 1, [&]()
+		{
+			fileSystem->Delete(cacheFileName);
+		}, [&](U32 i)
+		{
+			config->Load();
+		}));
+		config->Flush();
+
+		// every binding rewritten and the file written, as Apply in the controls menu does
+		PrintResult(RunBench(sizedName("config_save_action_map", unknownKeys), sizeSamples, 1, [&](U32 i)
+		{
+			config->SaveUserActionMap();
+			config->Save();
+			config->Flush();
+		}));
+	}
+
+	// leave a complete file without synthetic keys behind
+	WriteText(context, configFileName, savedConfig);
+	config->Load();
+	config->Flush();
+
+	// scripted frames switch one bound key per frame, gameplay queries every action
+	SharedPtr<ScriptedInput> scriptedInput(new ScriptedInput(context));
+	U32 frame = 0;
+	PrintResult(RunBench("action_key_input", samples, QUERIES_PER_SAMPLE, [&]()
+	{
+		Configuration::ActionUnit unit = config->GetActionUnit(static_cast<Configuration::GameInputActions>(frame % Configuration::ACTIONS_COUNT), 0);
+		bool press = (frame / Configuration::ACTIONS_COUNT) % 2 == 0;
+		if (unit.deviceType_ == Configuration::InputDeviceType::Keyboard)
+			press ? scriptedInput->PressKey(unit.key_) : scriptedInput->ReleaseKey(unit.key_);
+		else if (unit.deviceType_ == Configuration::InputDeviceType::Mouse)
+			press ? scriptedInput->PressMouseButton(unit.key_) : scriptedInput->ReleaseMouseButton(unit.key_);
+		scriptedInput->RunFrame();
+		frame++;
+	}, [&](U32 i)
+	{
+		KeepResult(config->GetActionKeyInput(static_cast<Configuration::GameInputActions>(i % Configuration::ACTIONS_COUNT)));
+	}));
+
+	PrintResult(RunBench("action_key_name", samples, QUERIES_PER_SAMPLE, [&](U32 i)
+	{
+		Configuration::GameInputActions action = static_cast<Configuration::GameInputActions>(i % Configuration::ACTIONS_COUNT);
+		KeepResult(config->GetActionKeyName(action, (i / Configuration::ACTIONS_COUNT) % Configuration::ACTION_UNITS_PER_ACTION).Length());
+	}));
+
+	// construction queues the UI resources in the background, it is part of the setup like a state change
+	SharedPtr<MenuControlsPropertiesState> controlsState;
+	PrintResult(RunBench("menu_controls_create_enter", Max(samples / 10, 10u), 1, [&]()
+	{
+		if (controlsState)
+			controlsState->Exit();
+		controlsState = new MenuControlsPropertiesState(context);
+	}, [&](U32 i)
+	{
+		controlsState->Create();
+		controlsState->Enter();
+	}));
+	controlsState->Exit();
+	controlsState.Reset();
+
+	PrintSkipped("menu_video_enter", "needs Graphics, the headless engine has none");
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+#include <Urho3D/Input/Input.h>
+
+#include "config.h"
+
+#include "benchCommon.h"
+
+#include <cstring>
+
+/**
+ * Throughput of the name tables: value to name, name to value through the perfect hash, and
+ * ParseConfig() of a controls section, which resolves every binding through them.
+ */
+
+static const U32 SAMPLES = 2000;
+static const U32 LOOKUPS_PER_SAMPLE = 256;
+static const U32 LOADS_PER_SAMPLE = 16;
+
+static const S32 MouseButtons[] = { MOUSEB_LEFT, MOUSEB_MIDDLE, MOUSEB_RIGHT, MOUSEB_X1, MOUSEB_X2 };
+static const U32 MOUSE_KEYS_COUNT = sizeof(MouseButtons) / sizeof(MouseButtons[0]);
+
+/// Every action with all of its bindings, in the layout SyncActionsToJson() writes.
+static String BuildControlsJson(const Configuration* config)
+{
+	String json = "{\"controls\":{";
+	for (U32 action = 0; action < Configuration::ACTIONS_COUNT; action++)
+	{
+		Configuration::GameInputActions inputAction = static_cast<Configuration::GameInputActions>(action);
+		json.AppendWithFormat("%s\"%s\":{", action ? "," : "", Configuration::StringFromEnumActions(inputAction));
+
+		bool first = true;
+		for (U32 unitNumber = 0; unitNumber < Configuration::ACTION_UNITS_PER_ACTION; unitNumber++)
+		{
+			Configuration::ActionUnit unit = config->GetActionUnit(inputAction, unitNumber);
+			if (unit.deviceType_ == Configuration::InputDeviceType::No_Device)
+				continue;
+
+			json.AppendWithFormat("%s\"%u\":{\"device\":\"%s\",\"key\":\"%s\"}", first ? "" : ",", unitNumber,
+				Configuration::StringFromDeviceType(unit.deviceType_), config->GetActionKeyName(inputAction, unitNumber).CString());
+			first = false;
+		}
+		json += "}";
+	}
+	json += "}}";
+	return json;
+}
+
+int main(int argc, char** argv)
+{
+	SharedPtr<Context> context(new Context());
+	SharedPtr<Engine> engine = CreateHeadlessEngine(context);
+	if (!engine)
+		return 1;
+
+	// not loaded, the default bindings are the document
+	Configuration* config = new Configuration(context);
+	context->RegisterSubsystem(config);
+	Input* input = context->GetSubsystem<Input>();
+
+	// names are prepared up front, lookups are measured on what the parser hands over
+	Vector<String> actionNames;
+	for (U32 action = 0; action < Configuration::ACTIONS_COUNT; action++)
+		actionNames.Push(Configuration::StringFromEnumActions(static_cast<Configuration::GameInputActions>(action)));
+	Vector<String> parameterNames;
+	for (U32 parameter = 0; parameter < static_cast<U32>(Configuration::ConfigParameter::Count); parameter++)
+		parameterNames.Push(Configuration::StringFromParameter(static_cast<Configuration::ConfigParameter>(parameter)));
+	Vector<String> mouseKeyNames;
+	for (S32 button : MouseButtons)
+		mouseKeyNames.Push(Configuration::MouseKeyName(button));
+	const String deviceNames[] = { "Keyboard", "Mouse" };
+	// same lengths as real names, so the miss is decided by the hash and not by a length check
+	const String missNames[] = { "MoveForwarx", "FirePrimarz", "Keyboarc", "MRIGHX" };
+
+	PrintResult(RunBench("name_action_to_string", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		KeepResult(static_cast<U32>(std::strlen(Configuration::StringFromEnumActions(static_cast<Configuration::GameInputActions>(i % Configuration::ACTIONS_COUNT)))));
+	}));
+
+	PrintResult(RunBench("name_device_to_string", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		Configuration::InputDeviceType device = i % 2 ? Configuration::InputDeviceType::Mouse : Configuration::InputDeviceType::Keyboard;
+		KeepResult(static_cast<U32>(std::strlen(Configuration::StringFromDeviceType(device))));
+	}));
+
+	PrintResult(RunBench("name_mouse_key_to_string", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		KeepResult(static_cast<U32>(std::strlen(Configuration::MouseKeyName(MouseButtons[i % MOUSE_KEYS_COUNT]))));
+	}));
+
+	PrintResult(RunBench("name_string_to_action", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		KeepResult(static_cast<U32>(Configuration::ActionFromName(actionNames[i % actionNames.Size()])));
+	}));
+
+	PrintResult(RunBench("name_string_to_parameter", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		KeepResult(static_cast<U32>(Configuration::ParameterFromName(parameterNames[i % parameterNames.Size()])));
+	}));
+
+	PrintResult(RunBench("name_string_to_device", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		KeepResult(static_cast<U32>(Configuration::DeviceTypeFromName(deviceNames[i % 2])));
+	}));
+
+	PrintResult(RunBench("name_string_to_mouse_key", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		KeepResult(static_cast<U32>(Configuration::MouseKeyFromName(mouseKeyNames[i % mouseKeyNames.Size()])));
+	}));
+
+	PrintResult(RunBench("name_string_miss", SAMPLES, LOOKUPS_PER_SAMPLE, [&](U32 i)
+	{
+		const String& name = missNames[i % 4];
+		KeepResult(static_cast<U32>(Configuration::ActionFromName(name)) + static_cast<U32>(Configuration::DeviceTypeFromName(name)) +
+			static_cast<U32>(Configuration::MouseKeyFromName(name)));
+	}));
+
+	// keyboard keys still go through Input::GetKeyFromName(), mouse keys and devices through the tables
+	String controlsJson = BuildControlsJson(config);
+	PrintResult(RunBench("name_load_controls", SAMPLES, LOADS_PER_SAMPLE, [&](U32 i)
+	{
+		Configuration::ParsedConfig parsed;
+		KeepResult(Configuration::ParseConfig(controlsJson.CString(), input, parsed));
+	}));
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include <Urho3D/IO/FileSystem.h>
+
+#include "config.h"
+
+#include "benchCommon.h"
+
+/**
+ * Configuration::Load() at startup through the binary cache and through config.json. The JSON path
+ * deletes the cache before every load and includes writing it again, as the first launch after an
+ * edit does. The cache path runs against the cache written by the JSON path.
+ */
+
+static const U32 SAMPLES = 200;
+
+int main(int argc, char** argv)
+{
+	SharedPtr<Context> context(new Context());
+	SharedPtr<Engine> engine = CreateHeadlessEngine(context);
+	if (!engine)
+		return 1;
+
+	FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+#ifdef _DEBUG
+	String configFileName = fileSystem->GetProgramDir() + "config_d.json";
+#else
+	String configFileName = fileSystem->GetProgramDir() + "config.json";
+#endif // _DEBUG
+	String cacheFileName = configFileName + ".cache";
+
+	Configuration* config = new Configuration(context);
+	context->RegisterSubsystem(config);
+
+	// the first load completes a missing or partial file, the save writes the cache
+	config->Load();
+	config->Flush();
+
+	PrintResult(RunBench("startup_load_json", SAMPLES, 1, [&]()
+	{
+		fileSystem->Delete(cacheFileName);
+	}, [&](U32 i)
+	{
+		config->Load();
+	}));
+
+	// written by the JSON path unless the file holds keys outside the schema
+	if (!fileSystem->FileExists(cacheFileName))
+	{
+		PrintSkipped("startup_load_cache", "no cache was written, the config has keys outside the schema");
+		return 0;
+	}
+
+	PrintResult(RunBench("startup_load_cache", SAMPLES, 1, [&](U32 i)
+	{
+		config->Load();
+	}));
+
+	// what a launch pays before the first frame, the previous instance is destroyed outside the timing
+	SharedPtr<Configuration> startupConfig;
+	PrintResult(RunBench("startup_construct_load_cache", SAMPLES, 1, [&]()
+	{
+		startupConfig.Reset();
+	}, [&](U32 i)
+	{
+		startupConfig = new Configuration(context);
+		startupConfig->Load();
+	}));
+	startupConfig.Reset();
+
+	return 0;
+}
@@ -1,7 +1,24 @@
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/Graphics.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Math/MathDefs.h>
+#include <Urho3D/Resource/ResourceEvents.h>
 
 #include "config.h"
+#include "trace.h"
+
+#include <rapidjson/reader.h>
+
+#include <cstring>
+#include <memory>
 
 #ifdef _DEBUG
 static const U32 DEFAULT_WIDTH = 1280;
@@ -22,110 +39,266 @@ static String DefaultLang = "en";
 static String DefaultServerAddress = "localhost";
 static const U32 DEFAULT_SERVER_PORT = 23450;
 
-HashMap<String, Variant> DefaultParameterValues =
+static const bool DEFAULT_VSYNC = false;
+static const bool DEFAULT_TRIPLE_BUFFER = false;
+static const U32 DEFAULT_MONITOR = 0;
+/// 0 selects the highest rate of the mode
+static const U32 DEFAULT_REFRESH_RATE = 0;
+/// Engine defaults, 0 is uncapped
+static const U32 DEFAULT_MAX_FPS = 200;
+static const U32 DEFAULT_MAX_INACTIVE_FPS = 60;
+/// record startup and state transition zones, written to trace.json on exit
+static const bool DEFAULT_TRACE = false;
+static const bool DEFAULT_PERF_OVERLAY = false;
+/// 0 detects the core count
+static const U32 DEFAULT_THREADS = 0;
+/// 0 gives every thread one batch
+static const U32 DEFAULT_TASK_BATCH_SIZE = 0;
+
+static const Configuration::ParameterMask ENGINE_PARAMETERS =
+	Configuration::ParameterBit(Configuration::ConfigParameter::MaxFps) |
+	Configuration::ParameterBit(Configuration::ConfigParameter::MaxInactiveFps);
+
+static Configuration::ConfigValues DefaultParameterValues()
+{
+	Configuration::ConfigValues values;
+#define CONFIG_PARAMETER_DEFAULT(id, name, type, defaultValue) values.name##_ = defaultValue;
+	CONFIG_PARAMETERS(CONFIG_PARAMETER_DEFAULT)
+#undef CONFIG_PARAMETER_DEFAULT
+
+	return values;
+}
+
+static void WriteCacheValue(Serializer& dest, U32 value) { dest.WriteUInt(value); }
+static void WriteCacheValue(Serializer& dest, bool value) { dest.WriteBool(value); }
+static void WriteCacheValue(Serializer& dest, F32 value) { dest.WriteFloat(value); }
+static void WriteCacheValue(Serializer& dest, const String& value) { dest.WriteString(value); }
+
+static void ReadCacheValue(Deserializer& source, U32& value) { value = source.ReadUInt(); }
+static void ReadCacheValue(Deserializer& source, bool& value) { value = source.ReadBool(); }
+static void ReadCacheValue(Deserializer& source, F32& value) { value = source.ReadFloat(); }
+static void ReadCacheValue(Deserializer& source, String& value) { value = source.ReadString(); }
+
+static void ReadVariant(const Variant& variant, U32& value) { value = variant.GetUInt(); }
+static void ReadVariant(const Variant& variant, bool& value) { value = variant.GetBool(); }
+static void ReadVariant(const Variant& variant, F32& value) { value = variant.GetFloat(); }
+static void ReadVariant(const Variant& variant, String& value) { value = variant.GetString(); }
+
+const Configuration::ActionMask Configuration::ALL_ACTIONS = Configuration::ActionMask().set();
+
+// constant-initialized, rows are binding slots and columns follow GameInputActions
+const Configuration::ActionBindings Configuration::DefaultActionBindings =
+{
+	// deviceTypes_
+	{
+		{
+			Configuration::InputDeviceType::Keyboard,   // MoveForward
+			Configuration::InputDeviceType::Keyboard,   // MoveBackward
+			Configuration::InputDeviceType::Keyboard,   // MoveLeft
+			Configuration::InputDeviceType::Keyboard,   // MoveRight
+			Configuration::InputDeviceType::Mouse,      // FirePrimary
+			Configuration::InputDeviceType::Mouse,      // FireSecondary
+			Configuration::InputDeviceType::Keyboard,   // FireThird
+			Configuration::InputDeviceType::Keyboard    // FireUltimate
+		},
+		{
+			Configuration::InputDeviceType::Keyboard,
+			Configuration::InputDeviceType::Keyboard,
+			Configuration::InputDeviceType::Keyboard,
+			Configuration::InputDeviceType::Keyboard
+		}
+	},
+	// keys_
+	{
+		{ KEY_W,  KEY_S,    KEY_A,    KEY_D,     MOUSEB_LEFT, MOUSEB_RIGHT, KEY_Q, KEY_E },
+		{ KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT }
+	}
+};
+
+/// FNV-1a, evaluated at compile time for case labels of the name switches below.
+static constexpr U32 ConstNameHash(const char* str, U32 hash = 2166136261u)
+{
+	return *str ? ConstNameHash(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 16777619u) : hash;
+}
+
+/// Runtime FNV-1a, must match ConstNameHash.
+static U32 NameHash(const char* str, U32 length)
 {
-	{ "width", DEFAULT_WIDTH },
-	{ "height", DEFAULT_HEIGHT },
-	{ "fullscreen", DEFAULT_FULLSCREEN },
-	{ "borderless", DEFAULT_BORDERLESS },
-	{ "sound", DEFAULT_SOUND_VOLUME },
-	{ "address", DefaultServerAddress },
-	{ "port", DEFAULT_SERVER_PORT },
-	{ "lang", DefaultLang }
+	U32 hash = 2166136261u;
+	for (U32 i = 0; i < length; i++)
+		hash = (hash ^ static_cast<unsigned char>(str[i])) * 16777619u;
+
+	return hash;
+}
+
+/*
+ * Name -> value lookups switch on the name hash. The compiler rejects duplicate case labels,
+ * so a hash collision inside a table fails the build and the hash is perfect for that table.
+ * The final comparison rejects names outside the table that happen to share a hash.
+ */
+#define CONFIG_NAME_CASE(name, value) \
+	case ConstNameHash(name): \
+		if (length == sizeof(name) - 1 && memcmp(str, name, length) == 0) \
+			return value; \
+		break;
+
+static const char* const ActionNames[] =
+{
+#define CONFIG_ACTION_NAME(name) #name,
+	CONFIG_INPUT_ACTIONS(CONFIG_ACTION_NAME)
+#undef CONFIG_ACTION_NAME
 };
+static_assert(sizeof(ActionNames) / sizeof(ActionNames[0]) == Configuration::ACTIONS_COUNT, "ActionNames does not match GameInputActions");
 
-Configuration::ActionsMap Configuration::DefaultActionsMap =
+static const char* const DeviceTypeNames[] =
 {
-	{ Configuration::GameInputActions::MoveForward,  {{0, {Configuration::InputDeviceType::Keyboard, KEY_W}}, {1, {Configuration::InputDeviceType::Keyboard, KEY_UP}}}},
-	{ Configuration::GameInputActions::MoveBackward, {{0, {Configuration::InputDeviceType::Keyboard, KEY_S}}, {1, {Configuration::InputDeviceType::Keyboard, KEY_DOWN}}}},
-	{ Configuration::GameInputActions::MoveLeft,     {{0, {Configuration::InputDeviceType::Keyboard, KEY_A}}, {1, {Configuration::InputDeviceType::Keyboard, KEY_LEFT}}}},
-	{ Configuration::GameInputActions::MoveRight,    {{0, {Configuration::InputDeviceType::Keyboard, KEY_D}}, {1, {Configuration::InputDeviceType::Keyboard, KEY_RIGHT}}}},
-	{ Configuration::GameInputActions::FirePrimary,  {{0, {Configuration::InputDeviceType::Mouse, MOUSEB_LEFT}}}},
-	{ Configuration::GameInputActions::FireSecondary,{{0, {Configuration::InputDeviceType::Mouse, MOUSEB_RIGHT}}}},
-	{ Configuration::GameInputActions::FireThird,    {{0, {Configuration::InputDeviceType::Keyboard, KEY_Q}}}},
-	{ Configuration::GameInputActions::FireUltimate, {{0, {Configuration::InputDeviceType::Keyboard, KEY_E}}}}
+	"",             // No_Device
+	"Mouse",
+	"Keyboard"
 };
+static_assert(sizeof(DeviceTypeNames) / sizeof(DeviceTypeNames[0]) == static_cast<U32>(Configuration::InputDeviceType::Count), "DeviceTypeNames does not match InputDeviceType");
 
-String Configuration::StringFromEnumActions(GameInputActions inputAction)
-{
-	switch (inputAction)
-	{
-		case GameInputActions::MoveForward:
-			return "MoveForward";
-		case GameInputActions::MoveBackward:
-			return "MoveBackward";
-		case GameInputActions::MoveLeft:
-			return "MoveLeft";
-		case GameInputActions::MoveRight:
-			return "MoveRight";
-		case GameInputActions::FirePrimary:
-			return "FirePrimary";
-		case GameInputActions::FireSecondary:
-			return "FireSecondary";
-		case GameInputActions::FireThird:
-			return "FireThird";
-		case GameInputActions::FireUltimate:
-			return "FireUltimate";
-		default:
-			return "";
+struct MouseKeyDescriptor
+{
+	const char* name_;
+	S32         key_;
+};
+
+#define CONFIG_MOUSE_KEYS(X) \
+	X("MLEFT", MOUSEB_LEFT) \
+	X("MMIDDLE", MOUSEB_MIDDLE) \
+	X("MRIGHT", MOUSEB_RIGHT) \
+	X("MX1", MOUSEB_X1) \
+	X("MX2", MOUSEB_X2)
+
+static const MouseKeyDescriptor MouseKeys[] =
+{
+#define CONFIG_MOUSE_KEY_DESCRIPTOR(name, key) { name, key },
+	CONFIG_MOUSE_KEYS(CONFIG_MOUSE_KEY_DESCRIPTOR)
+#undef CONFIG_MOUSE_KEY_DESCRIPTOR
+};
+
+static const char* const ParameterNames[] =
+{
+#define CONFIG_PARAMETER_NAME(id, name, type, defaultValue) #name,
+	CONFIG_PARAMETERS(CONFIG_PARAMETER_NAME)
+#undef CONFIG_PARAMETER_NAME
+};
+
+const char* Configuration::StringFromParameter(ConfigParameter parameter)
+{
+	if (parameter >= ConfigParameter::Count)
+		return "";
+
+	return ParameterNames[static_cast<U32>(parameter)];
+}
+
+Configuration::ConfigParameter Configuration::ParameterFromName(const char* str, U32 length)
+{
+	switch (NameHash(str, length))
+	{
+#define CONFIG_PARAMETER_CASE(id, name, type, defaultValue) CONFIG_NAME_CASE(#name, ConfigParameter::id)
+		CONFIG_PARAMETERS(CONFIG_PARAMETER_CASE)
+#undef CONFIG_PARAMETER_CASE
 	}
+
+	return ConfigParameter::Count;
 }
 
-String Configuration::StringFromDeviceType(InputDeviceType deviceType)
+const char* Configuration::StringFromEnumActions(GameInputActions inputAction)
 {
-	switch (deviceType)
+	if (inputAction >= GameInputActions::Count)
+		return "";
+
+	return ActionNames[static_cast<U32>(inputAction)];
+}
+
+const char* Configuration::StringFromDeviceType(InputDeviceType deviceType)
+{
+	if (deviceType >= InputDeviceType::Count)
+		return "";
+
+	return DeviceTypeNames[static_cast<U32>(deviceType)];
+}
+
+const char* Configuration::MouseKeyName(S32 key)
+{
+	for (const MouseKeyDescriptor& mouseKey : MouseKeys)
 	{
-		case InputDeviceType::Keyboard:
-			return "Keyboard";
-		case InputDeviceType::Mouse:
-			return "Mouse";
-		default:
-			return "";
+		if (mouseKey.key_ == key)
+			return mouseKey.name_;
+	}
+
+	return "";
+}
+
+Configuration::GameInputActions Configuration::ActionFromName(const char* str, U32 length)
+{
+	switch (NameHash(str, length))
+	{
+#define CONFIG_ACTION_CASE(action) CONFIG_NAME_CASE(#action, GameInputActions::action)
+		CONFIG_INPUT_ACTIONS(CONFIG_ACTION_CASE)
+#undef CONFIG_ACTION_CASE
 	}
+
+	return GameInputActions::Count;
 }
 
-String Configuration::MouseKeyName(S32 key)
+Configuration::InputDeviceType Configuration::DeviceTypeFromName(const String& name)
 {
-	switch (key)
+	const char* str = name.CString();
+	U32 length = name.Length();
+	switch (NameHash(str, length))
 	{
-		case MOUSEB_LEFT:
-			return "MLEFT";
-		case MOUSEB_MIDDLE:
-			return "MMIDDLE";
-		case MOUSEB_RIGHT:
-			return "MRIGHT";
-		case MOUSEB_X1:
-			return "MX1";
-		case MOUSEB_X2:
-			return "MX2";
+		CONFIG_NAME_CASE("Mouse", InputDeviceType::Mouse)
+		CONFIG_NAME_CASE("Keyboard", InputDeviceType::Keyboard)
 	}
 
-	return String::EMPTY;
+	return InputDeviceType::No_Device;
 }
 
 S32 Configuration::MouseKeyFromName(const String& name)
 {
-	S32 key = 0;
-	if (name == "MLEFT")
-		key = MOUSEB_LEFT;
-	else if (name == "MMIDDLE")
-		key = MOUSEB_MIDDLE;
-	else if (name == "MRIGHT")
-		key = MOUSEB_RIGHT;
-	else if (name == "MX1")
-		key = MOUSEB_X1;
-	else if (name == "MX2")
-		key = MOUSEB_X2;
+	const char* str = name.CString();
+	U32 length = name.Length();
+	switch (NameHash(str, length))
+	{
+		CONFIG_MOUSE_KEYS(CONFIG_NAME_CASE)
+	}
+
+	return 0;
+}
+
+const String& Configuration::StringFromKey(InputDeviceType deviceType, S32 key) const
+{
+	ActionUnit unit(deviceType, key);
+	auto labelIt = keyLabels_.find(unit);
+	if (labelIt != keyLabels_.end())
+		return labelIt->second;
+
+	if (deviceType == InputDeviceType::No_Device)
+		return String::EMPTY;
 
-	return key;
+	// only keyboard names need Input
+	Input* input = GetSubsystem<Input>();
+	if (!input && deviceType == InputDeviceType::Keyboard)
+		return String::EMPTY;
+
+	return keyLabels_[unit] = ResolveKeyName(input, deviceType, key);
 }
 
-String Configuration::StringFromKey(InputDeviceType deviceType, S32 key) const
+void Configuration::RefreshKeyLabels()
 {
 	Input* input = GetSubsystem<Input>();
 	if (!input)
-		return String::EMPTY;
+		return;
+
+	for (auto& label : keyLabels_)
+		label.second = ResolveKeyName(input, label.first.deviceType_, label.first.key_);
+}
 
+String Configuration::ResolveKeyName(Input* input, InputDeviceType deviceType, S32 key) const
+{
 	switch (deviceType)
 	{
 		case InputDeviceType::Keyboard:
@@ -144,210 +317,1512 @@ String Configuration::StringFromKey(InputDeviceType deviceType, S32 key) const
 Configuration::Configuration(Context* context)
 	: Object(context)
 	, jsonFile_(context)
+	, fileValues_(DefaultParameterValues())
+	, values_(DefaultParameterValues())
 {
+	TRACE_ZONE(ConfigConstruct);
+
 	FileSystem* filesystem = GetSubsystem<FileSystem>();
+	fileSystem_ = filesystem;
+	workQueue_ = GetSubsystem<WorkQueue>();
 
 #ifdef _DEBUG
 	configFileName_ = filesystem->GetProgramDir() + "config_d.json";
 #else
 	configFileName_ = filesystem->GetProgramDir() + "config.json";
 #endif // _DEBUG
+	cacheFileName_ = configFileName_ + ".cache";
+	watchedFileName_ = GetFileNameAndExtension(configFileName_);
+
+	SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Configuration, HandleBeginFrame));
+	// Input subscribes to E_BEGINFRAME only once Graphics is up, after us. E_INPUTEND follows the
+	// key events it dispatches in that frame
+	SubscribeToEvent(E_INPUTEND, URHO3D_HANDLER(Configuration, HandleInputEnd));
+
+	SubscribeToEvent(E_KEYDOWN, URHO3D_HANDLER(Configuration, HandleKeyDown));
+	SubscribeToEvent(E_KEYUP, URHO3D_HANDLER(Configuration, HandleKeyUp));
+	SubscribeToEvent(E_MOUSEBUTTONDOWN, URHO3D_HANDLER(Configuration, HandleMouseButtonDown));
+	SubscribeToEvent(E_MOUSEBUTTONUP, URHO3D_HANDLER(Configuration, HandleMouseButtonUp));
+	SubscribeToEvent(E_INPUTFOCUS, URHO3D_HANDLER(Configuration, HandleInputFocus));
+	SubscribeToEvent(E_CHANGELANGUAGE, URHO3D_HANDLER(Configuration, HandleChangeLanguage));
+
+	if (workQueue_)
+		SubscribeToEvent(workQueue_, E_WORKITEMCOMPLETED, URHO3D_HANDLER(Configuration, HandleWorkItemCompleted));
+
+	// not every platform or build has a file watcher, then edits apply on the next start
+	configWatcher_ = new FileWatcher(context_);
+	if (!configWatcher_->StartWatching(GetPath(configFileName_), false))
+		configWatcher_.Reset();
+
+	userActionBindings_ = DefaultActionBindings;
+	fileBindings_ = DefaultActionBindings;
+	uncommittedParameters_ = ALL_PARAMETERS;
+	Commit();
 }
 
-void Configuration::Load()
+Configuration::~Configuration()
 {
-	bool loadingFailed = true;
-	bool needStoring = false;
-	FileSystem* filesystem = GetSubsystem<FileSystem>();
-	if (filesystem->FileExists(configFileName_))
-	{
-		File configFile(context_, configFileName_, FILE_READ);
-		if (jsonFile_.BeginLoad(configFile))
-		{
-			loadingFailed = false;
+	// Flush() completes the reload item too, its result is no longer wanted
+	UnsubscribeFromEvent(E_WORKITEMCOMPLETED);
+	Flush();
 
-			JSONValue& root = jsonFile_.GetRoot();
-			for (auto& defaultValue : DefaultParameterValues)
-			{
-				if (!root.Contains(defaultValue.first_))
-				{
-					SetValue(defaultValue.first_, defaultValue.second_);
-					needStoring = true;
-				}
-			}
+	if (Tracer::IsEnabled())
+		Tracer::Write(context_, GetPath(configFileName_) + "trace.json");
 
-			userActionMap_ = DefaultActionsMap;
-			if (!root.Contains("controls"))
-			{
-				SaveUserActionMap();
-				needStoring = true;
-			}
-			else
-			{
-				LoadActionMap();
-			}
-		}
-	}
-	
+	// no reader may call GetSnapshot() any more, a SnapshotRef still held keeps its snapshot alive
+	for (const Snapshot* snapshot : retiredSnapshots_)
+		ReleaseSnapshot(snapshot);
+	ReleaseSnapshot(snapshot_.load());
+}
 
-	if(loadingFailed)
+void Configuration::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+	if (configWatcher_)
 	{
-		JSONValue& root = jsonFile_.GetRoot();
-		for (auto& defaultValue : DefaultParameterValues)
+		String changedFile;
+		while (configWatcher_->GetNextChange(changedFile))
 		{
-			SetValue(defaultValue.first_, defaultValue.second_);
+			if (changedFile == watchedFileName_)
+				reloadRequested_ = true;
 		}
 
-		userActionMap_ = DefaultActionsMap;
-		SaveUserActionMap();
-
-		needStoring = true;
+		if (reloadRequested_ && !reloadItem_)
+			StartReload();
 	}
 
-	if (needStoring)
-	{
-		Save();
-	}
+	// retried until the window is open
+	if (displaySettingsPending_ && ApplyDisplaySettings())
+		displaySettingsPending_ = false;
+
+	Commit();
+	ReclaimSnapshots();
+
+	if (saveRequested_ && saveTimer_.GetMSec(false) >= SAVE_COALESCE_MSEC)
+		DispatchSave();
 }
 
-void Configuration::Save()
+void Configuration::HandleInputEnd(StringHash eventType, VariantMap& eventData)
 {
-	File configFile(context_, configFileName_, FILE_WRITE);
-	jsonFile_.Save(configFile);
+	actionsDown_ = actionsHeld_;
+	actionsPressed_ = actionsPressedPending_;
+	actionsReleased_ = actionsReleasedPending_;
+
+	actionsPressedPending_.reset();
+	actionsReleasedPending_.reset();
 }
 
-void Configuration::LoadActionMap()
+void Configuration::HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData)
 {
-	Input* input = GetSubsystem<Input>();
-	if (!input)
+	using namespace WorkItemCompleted;
+
+	if (!reloadItem_ || eventData[P_ITEM].GetVoidPtr() != reloadItem_.Get())
 		return;
 
-	JSONValue& controlsJson = jsonFile_.GetRoot()["controls"];
+	reloadItem_.Reset();
+	ApplyReload();
+}
 
-	for (U32 action = static_cast<U32>(GameInputActions::MoveForward); action < static_cast<U32>(GameInputActions::Count); action++)
-	{
-		String actionName = StringFromEnumActions(static_cast<GameInputActions>(action));
-		if (controlsJson.Contains(actionName))
-		{
-			auto& userAction = userActionMap_[static_cast<GameInputActions>(action)];
+void Configuration::HandleKeyDown(StringHash eventType, VariantMap& eventData)
+{
+	using namespace KeyDown;
 
-			auto controlSetJson = controlsJson[actionName].GetArray();
+	if (eventData[P_REPEAT].GetBool())
+		return;
 
-			for (U32 actionUnitNumber = 0; actionUnitNumber < 2; actionUnitNumber++)
-			{
-				if (!controlsJson[actionName].Contains(String(actionUnitNumber)))
-					continue;
+	OnActionUnitInput(InputDeviceType::Keyboard, eventData[P_KEY].GetInt(), true);
+}
 
-				auto& controlUnitJson = controlsJson[actionName][String(actionUnitNumber)];
-				String deviceStr = controlUnitJson["device"].GetString();
-				String keyStr = controlUnitJson["key"].GetString();
+void Configuration::HandleKeyUp(StringHash eventType, VariantMap& eventData)
+{
+	using namespace KeyUp;
 
-				S32 key = KEY_UNKNOWN;
-				if (deviceStr == "Keyboard")
-				{
-					key = input->GetKeyFromName(keyStr);
-					userAction[actionUnitNumber].deviceType_ = InputDeviceType::Keyboard;
-				}
-				else if (deviceStr == "Mouse")
-				{
-					key = MouseKeyFromName(keyStr);
-					userAction[actionUnitNumber].deviceType_ = InputDeviceType::Mouse;
-				}
+	OnActionUnitInput(InputDeviceType::Keyboard, eventData[P_KEY].GetInt(), false);
+}
 
-				userAction[actionUnitNumber].key_ = key;
-			}
-		}
+void Configuration::HandleMouseButtonDown(StringHash eventType, VariantMap& eventData)
+{
+	using namespace MouseButtonDown;
+
+	OnActionUnitInput(InputDeviceType::Mouse, eventData[P_BUTTON].GetInt(), true);
+}
+
+void Configuration::HandleMouseButtonUp(StringHash eventType, VariantMap& eventData)
+{
+	using namespace MouseButtonUp;
+
+	OnActionUnitInput(InputDeviceType::Mouse, eventData[P_BUTTON].GetInt(), false);
+}
+
+void Configuration::HandleInputFocus(StringHash eventType, VariantMap& eventData)
+{
+	// Input drops key states without sending key up events when focus changes
+	ResyncHeldActions();
+
+	// keyboard layout may have been switched while the window was inactive
+	using namespace InputFocus;
+	if (eventData[P_FOCUS].GetBool())
+		RefreshKeyLabels();
+}
+
+void Configuration::HandleChangeLanguage(StringHash eventType, VariantMap& eventData)
+{
+	RefreshKeyLabels();
+}
+
+void Configuration::OnActionUnitInput(InputDeviceType device, S32 key, bool down)
+{
+	auto indexIt = actionIndex_.find(ActionUnit(device, key));
+	if (indexIt == actionIndex_.end())
+		return;
+
+	long long time = GetInputTime();
+
+	const ActionMask& actions = indexIt->second;
+	for (U32 action = 0; action < ACTIONS_COUNT; action++)
+	{
+		if (!actions[action])
+			continue;
+
+		U32& heldCount = actionHeldCounts_[action];
+		if (down)
+			heldCount++;
+		else if (heldCount > 0)
+			heldCount--;
+
+		UpdateActionHeld(action, heldCount > 0, time);
 	}
 }
 
-void Configuration::SaveUserActionMap()
+void Configuration::UpdateActionHeld(U32 action, bool held, long long time)
 {
-	Input* input = GetSubsystem<Input>();
-	if (!input)
+	if (actionsHeld_[action] == held)
 		return;
 
-	JSONValue& root = jsonFile_.GetRoot();
-	root["controls"] = JSONValue();
+	actionsHeld_[action] = held;
+	if (held)
+		actionsPressedPending_.set(action);
+	else
+		actionsReleasedPending_.set(action);
 
-	JSONValue& controlsJson = root["controls"];
-	for (auto& userAction : userActionMap_)
+	PushActionEvent(action, held, time);
+}
+
+void Configuration::PushActionEvent(U32 action, bool pressed, long long time)
+{
+	if (actionEventsCount_ == ACTION_EVENT_QUEUE_SIZE)
 	{
-		String actionName = StringFromEnumActions(userAction.first);
+		// nobody may be polling, e.g. in menus, so overflow is only counted
+		droppedActionEvents_++;
+		actionEventsStart_ = (actionEventsStart_ + 1) % ACTION_EVENT_QUEUE_SIZE;
+		actionEventsCount_--;
+	}
+
+	ActionEvent& actionEvent = actionEvents_[(actionEventsStart_ + actionEventsCount_) % ACTION_EVENT_QUEUE_SIZE];
+	actionEvent.action_ = static_cast<GameInputActions>(action);
+	actionEvent.pressed_ = pressed;
+	actionEvent.time_ = time;
+	actionEvent.heldDuration_ = 0;
+
+	if (pressed)
+		actionPressTimes_[action] = time;
+	else
+		actionEvent.heldDuration_ = time - actionPressTimes_[action];
+
+	actionEventsCount_++;
+}
+
+bool Configuration::PollActionEvent(ActionEvent& actionEvent)
+{
+	if (!actionEventsCount_)
+		return false;
+
+	actionEvent = actionEvents_[actionEventsStart_];
+	actionEventsStart_ = (actionEventsStart_ + 1) % ACTION_EVENT_QUEUE_SIZE;
+	actionEventsCount_--;
+
+	return true;
+}
+
+void Configuration::RebuildActionIndex()
+{
+	actionIndex_.clear();
 
-		for (auto& userActionUnit : userAction.second)
+	for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION; unitNumber++)
+	{
+		for (U32 action = 0; action < ACTIONS_COUNT; action++)
 		{
-			controlsJson[actionName][String(userActionUnit.first)] = JSONValue();
-			JSONValue& actionUnitJson = controlsJson[actionName][String(userActionUnit.first)];
-
-			actionUnitJson["device"] = StringFromDeviceType(userActionUnit.second.deviceType_);
-			if (userActionUnit.second.deviceType_ == InputDeviceType::Keyboard)
-				actionUnitJson["key"] = input->GetKeyName(userActionUnit.second.key_);
-			else if (userActionUnit.second.deviceType_ == InputDeviceType::Mouse)
-				actionUnitJson["key"] = MouseKeyName(userActionUnit.second.key_);
+			InputDeviceType deviceType = userActionBindings_.deviceTypes_[unitNumber][action];
+			if (deviceType == InputDeviceType::No_Device)
+				continue;
+
+			S32 key = userActionBindings_.keys_[unitNumber][action];
+			actionIndex_[ActionUnit(deviceType, key)].set(action);
+
+			// saves read names from the label cache, the last one may run after Input is destroyed
+			StringFromKey(deviceType, key);
 		}
 	}
+
+	ResyncHeldActions();
 }
 
-void Configuration::SetValue(const String& name, Variant value)
+void Configuration::ResyncHeldActions()
 {
-	jsonFile_.GetRoot()[name].SetVariant(value);
+	Input* input = GetSubsystem<Input>();
+	if (!input)
+		return;
+
+	long long time = GetInputTime();
+	for (U32 action = 0; action < ACTIONS_COUNT; action++)
+		ResyncHeldAction(input, action, time);
 }
 
-Variant Configuration::GetValue(const String& name) const
+void Configuration::ResyncHeldAction(Input* input, U32 action, long long time)
 {
-	return jsonFile_.GetRoot()[name].GetVariant();
+	GameInputActions inputAction = static_cast<GameInputActions>(action);
+
+	U32 heldCount = 0;
+	for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION; unitNumber++)
+	{
+		ActionUnit unit = userActionBindings_.Get(inputAction, unitNumber);
+
+		// a key bound to several slots of one action is counted once, as in actionIndex_
+		bool duplicate = false;
+		for (U32 previousUnit = 0; previousUnit < unitNumber && !duplicate; previousUnit++)
+			duplicate = userActionBindings_.Get(inputAction, previousUnit) == unit;
+
+		if (duplicate)
+			continue;
+
+		if ((unit.deviceType_ == InputDeviceType::Keyboard && input->GetKeyDown(unit.key_)) ||
+			(unit.deviceType_ == InputDeviceType::Mouse && input->GetMouseButtonDown(unit.key_)))
+			heldCount++;
+	}
+
+	actionHeldCounts_[action] = heldCount;
+	UpdateActionHeld(action, heldCount > 0, time);
 }
 
-bool Configuration::GetActionKeyInput(GameInputActions action) const
+/// Same hash as File::GetChecksum, so cached checksums compare against the file on disk.
+static U32 ContentChecksum(const void* data, U32 size)
 {
-	Input* input = GetSubsystem<Input>();
-	if (!input)
-		return false;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
 
-	auto userActionIt = userActionMap_.find(action);
-	if (userActionIt == userActionMap_.end())
-		return false;
+	U32 checksum = 0;
+	for (U32 i = 0; i < size; i++)
+		checksum = SDBMHash(checksum, bytes[i]);
+
+	return checksum;
+}
+
+/// Changes whenever the binary layout of cached values or bindings changes.
+static const U32 CACHE_LAYOUT = Configuration::CACHE_VERSION |
+	(Configuration::ACTIONS_COUNT << 8) |
+	(Configuration::ACTION_UNITS_PER_ACTION << 16) |
+	(static_cast<U32>(Configuration::ConfigParameter::Count) << 24);
 
-	bool keyInputWorked = false;
-	auto& userAction = userActionIt->second;
+void Configuration::WriteCachePayload(Serializer& dest, const ParsedConfig& parsed)
+{
+	dest.WriteUInt(parsed.foundParameters_);
+	dest.WriteBool(parsed.hasControls_);
+
+#define CONFIG_PARAMETER_WRITE_CACHE(id, name, type, defaultValue) WriteCacheValue(dest, parsed.values_.name##_);
+	CONFIG_PARAMETERS(CONFIG_PARAMETER_WRITE_CACHE)
+#undef CONFIG_PARAMETER_WRITE_CACHE
 
-	for (auto& userActionUnit : userAction)
+	for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION; unitNumber++)
 	{
-		if (userActionUnit.second.deviceType_ == InputDeviceType::Keyboard)
+		for (U32 action = 0; action < ACTIONS_COUNT; action++)
 		{
-			keyInputWorked = keyInputWorked || input->GetKeyDown(userActionUnit.second.key_);
+			dest.WriteUByte(static_cast<unsigned char>(parsed.bindings_.deviceTypes_[unitNumber][action]));
+			dest.WriteInt(parsed.bindings_.keys_[unitNumber][action]);
 		}
-		else if (userActionUnit.second.deviceType_ == InputDeviceType::Mouse)
+	}
+}
+
+void Configuration::ReadCachePayload(Deserializer& source, ParsedConfig& parsed)
+{
+	parsed.foundParameters_ = source.ReadUInt();
+	parsed.hasControls_ = source.ReadBool();
+
+#define CONFIG_PARAMETER_READ_CACHE(id, name, type, defaultValue) ReadCacheValue(source, parsed.values_.name##_);
+	CONFIG_PARAMETERS(CONFIG_PARAMETER_READ_CACHE)
+#undef CONFIG_PARAMETER_READ_CACHE
+
+	for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION; unitNumber++)
+	{
+		for (U32 action = 0; action < ACTIONS_COUNT; action++)
 		{
-			keyInputWorked = keyInputWorked || input->GetMouseButtonDown(userActionUnit.second.key_);
+			U32 deviceType = source.ReadUByte();
+			parsed.bindings_.deviceTypes_[unitNumber][action] = deviceType < static_cast<U32>(InputDeviceType::Count) ?
+				static_cast<InputDeviceType>(deviceType) : InputDeviceType::No_Device;
+			parsed.bindings_.keys_[unitNumber][action] = source.ReadInt();
 		}
 	}
+}
+
+bool Configuration::LoadCache(ParsedConfig& parsed)
+{
+	TRACE_ZONE(ConfigLoadCache);
+
+	FileSystem* filesystem = GetSubsystem<FileSystem>();
+	if (!filesystem->FileExists(cacheFileName_) || !filesystem->FileExists(configFileName_))
+		return false;
+
+	File cacheFile(context_, cacheFileName_, FILE_READ);
+	if (cacheFile.ReadFileID() != "CFGC" || cacheFile.ReadUInt() != CACHE_LAYOUT)
+		return false;
+
+	U32 jsonSize = cacheFile.ReadUInt();
+	U32 jsonModified = cacheFile.ReadUInt();
+	U32 jsonChecksum = cacheFile.ReadUInt();
+	U32 payloadSize = cacheFile.ReadUInt();
+	U32 payloadChecksum = cacheFile.ReadUInt();
+
+	if (jsonModified != filesystem->GetLastModifiedTime(configFileName_))
+		return false;
+
+	File configFile(context_, configFileName_, FILE_READ);
+	if (configFile.GetSize() != jsonSize || configFile.GetChecksum() != jsonChecksum)
+		return false;
+
+	PODVector<unsigned char> payload(payloadSize);
+	if (!payloadSize || cacheFile.Read(&payload[0], payloadSize) != payloadSize ||
+		ContentChecksum(&payload[0], payloadSize) != payloadChecksum)
+		return false;
 
-	return keyInputWorked;
+	MemoryBuffer payloadBuffer(payload);
+	ReadCachePayload(payloadBuffer, parsed);
+
+	return true;
 }
 
-String Configuration::GetActionKeyName(GameInputActions action, U32 unitNumber) const
+bool Configuration::WriteCacheFile(const void* json, U32 jsonSize, const PODVector<unsigned char>& payload)
 {
-	auto userActionIt = userActionMap_.find(action);
-	if (userActionIt == userActionMap_.end())
-		return String::EMPTY;
+	if (!fileSystem_ || payload.Empty())
+		return false;
 
-	auto& userAction = userActionIt->second;
+	File cacheFile(context_, cacheFileName_, FILE_WRITE);
+	if (!cacheFile.IsOpen())
+		return false;
 
-	auto userActionUnitIt = userAction.find(unitNumber);
-	if (userActionUnitIt == userAction.end())
-		return String::EMPTY;
+	// header is checked field by field and the payload by checksum, so a torn write is only a cache miss
+	cacheFile.WriteFileID("CFGC");
+	cacheFile.WriteUInt(CACHE_LAYOUT);
+	cacheFile.WriteUInt(jsonSize);
+	cacheFile.WriteUInt(fileSystem_->GetLastModifiedTime(configFileName_));
+	cacheFile.WriteUInt(ContentChecksum(json, jsonSize));
+	cacheFile.WriteUInt(payload.Size());
+	cacheFile.WriteUInt(ContentChecksum(&payload[0], payload.Size()));
 
-	return StringFromKey(userActionUnitIt->second.deviceType_, userActionUnitIt->second.key_);
+	return cacheFile.Write(&payload[0], payload.Size()) == payload.Size();
 }
 
-void Configuration::SetActionKey(GameInputActions action, InputDeviceType device, S32 key, U32 unitNumber)
+void Configuration::Load()
 {
-	auto& userAction = userActionMap_[action];
+	TRACE_ZONE(ConfigLoad);
+
+	FileSystem* filesystem = GetSubsystem<FileSystem>();
+
+	// a save interrupted between delete and rename leaves only the temporary file
+	String tempFileName = configFileName_ + ".tmp";
+	if (!filesystem->FileExists(configFileName_) && filesystem->FileExists(tempFileName))
+		filesystem->Rename(tempFileName, configFileName_);
+
+	ParsedConfig parsed;
+	parsed.values_ = DefaultParameterValues();
+	parsed.bindings_ = DefaultActionBindings;
+
+	bool loaded = LoadCache(parsed);
+	bool loadedFromCache = loaded;
+	PODVector<char> content;
+	if (!loaded && filesystem->FileExists(configFileName_))
+	{
+		TRACE_ZONE(ConfigParseJSON);
+
+		File configFile(context_, configFileName_, FILE_READ);
+		content.Resize(configFile.GetSize() + 1);
+		content[configFile.Read(&content[0], configFile.GetSize())] = '\0';
+
+		loaded = ParseConfig(&content[0], GetSubsystem<Input>(), parsed);
+	}
 
-	userAction[unitNumber].deviceType_ = device;
-	userAction[unitNumber].key_ = key;
+	if (!loaded)
+	{
+		parsed = ParsedConfig();
+		parsed.values_ = DefaultParameterValues();
+		parsed.bindings_ = DefaultActionBindings;
+	}
+
+	values_ = parsed.values_;
+	userActionBindings_ = parsed.bindings_;
+	fileValues_ = parsed.values_;
+	fileBindings_ = parsed.bindings_;
+
+	// missing keys are written back with their defaults
+	dirtyParameters_ = (ALL_PARAMETERS & ~parsed.foundParameters_) | parsed.legacyParameters_;
+	dirtyActions_ = parsed.hasControls_ ? ActionMask() : ALL_ACTIONS;
+
+	// the DOM is only needed to round-trip keys outside the schema, otherwise it is rebuilt from typed storage on save
+	jsonFile_.GetRoot() = JSONValue();
+	jsonIncomplete_ = true;
+	jsonHasUnknownKeys_ = parsed.hasUnknownKeys_;
+	if (parsed.hasUnknownKeys_ && jsonFile_.FromString(&content[0]))
+		jsonIncomplete_ = false;
+
+	RebuildActionIndex();
+
+	uncommittedParameters_ = ALL_PARAMETERS;
+	uncommittedActions_ = ALL_ACTIONS;
+	Commit();
+
+	if (dirtyParameters_ || dirtyActions_.any())
+	{
+		// the save refreshes the cache
+		Save();
+	}
+	else if (loaded && !loadedFromCache && !jsonHasUnknownKeys_)
+	{
+		VectorBuffer payload;
+		WriteCachePayload(payload, parsed);
+		WriteCacheFile(&content[0], content.Size() - 1, payload.GetBuffer());
+	}
+
+	// recording ran since start to cover this load, keep it only when asked for
+	Tracer::Enable(values_.trace_);
 
-	SaveUserActionMap();
+	// not from Commit(), the constructor's commit of the defaults would create the threads before the user's value is known
+	ApplyWorkerThreads();
+
+	// the window usually opens after Load(), display settings missing from its engine parameters follow on its first frame
+	displaySettingsPending_ = true;
 }
 
+void Configuration::Commit()
+{
+	if (!uncommittedParameters_ && uncommittedActions_.none())
+		return;
+
+	Snapshot* snapshot = new Snapshot();
+	snapshot->values_ = values_;
+	snapshot->bindings_ = userActionBindings_;
+
+	const Snapshot* previous = snapshot_.load(std::memory_order_relaxed);
+	snapshot->revision_ = previous ? previous->revision_ + 1 : 0;
+
+	// only the main thread stores, readers may load concurrently
+	snapshot_.store(snapshot);
+	if (previous)
+		retiredSnapshots_.Push(previous);
+	ReclaimSnapshots();
+
+	ParameterMask parameters = uncommittedParameters_;
+	ActionMask actions = uncommittedActions_;
+
+	uncommittedParameters_ = 0;
+	uncommittedActions_.reset();
+
+	if (parameters & ENGINE_PARAMETERS)
+		ApplyEngineSettings();
+
+	NotifyChanges(parameters, actions);
+}
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_POINTER_LOCK_FREE == 2, "snapshot readers must not block");
+
+Configuration::SnapshotRef Configuration::GetSnapshot() const
+{
+	// sequentially consistent against the store and the reader count check in Commit(): a reader either
+	// loads the new pointer or is counted until its reference on the old one is taken
+	snapshotReaders_.fetch_add(1);
+	const Snapshot* snapshot = snapshot_.load();
+	if (snapshot)
+		snapshot->refs_.fetch_add(1, std::memory_order_relaxed);
+	snapshotReaders_.fetch_sub(1);
+
+	return SnapshotRef(snapshot);
+}
+
+void Configuration::ReleaseSnapshot(const Snapshot* snapshot)
+{
+	if (snapshot && snapshot->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		delete snapshot;
+}
+
+void Configuration::ReclaimSnapshots()
+{
+	// readers are inside GetSnapshot() for a few instructions, busy frames retry on the next one
+	if (retiredSnapshots_.Empty() || snapshotReaders_.load())
+		return;
+
+	for (const Snapshot* snapshot : retiredSnapshots_)
+		ReleaseSnapshot(snapshot);
+
+	retiredSnapshots_.Clear();
+}
+
+void Configuration::ApplyEngineSettings()
+{
+	Engine* engine = GetSubsystem<Engine>();
+	if (!engine)
+		return;
+
+	engine->SetMaxFps(values_.maxFps_);
+	engine->SetMaxInactiveFps(values_.maxInactiveFps_);
+}
+
+void Configuration::FillEngineParameters(VariantMap& engineParameters) const
+{
+	engineParameters[EP_WINDOW_WIDTH] = values_.width_;
+	engineParameters[EP_WINDOW_HEIGHT] = values_.height_;
+	engineParameters[EP_FULL_SCREEN] = values_.fullscreen_;
+	engineParameters[EP_BORDERLESS] = values_.borderless_;
+	engineParameters[EP_VSYNC] = values_.vsync_;
+	engineParameters[EP_TRIPLE_BUFFER] = values_.tripleBuffer_;
+	engineParameters[EP_MONITOR] = values_.monitor_;
+	engineParameters[EP_REFRESH_RATE] = values_.refreshRate_;
+}
+
+bool Configuration::ApplyDisplaySettings()
+{
+	Graphics* graphics = GetSubsystem<Graphics>();
+	if (!graphics || !graphics->IsInitialized())
+		return false;
+
+	// a monitor that is gone keeps the current one, refresh rate 0 keeps what the mode has
+	S32 monitor = static_cast<S32>(values_.monitor_) < graphics->GetMonitorCount() ? static_cast<S32>(values_.monitor_) : graphics->GetCurrentMonitor();
+	S32 refreshRate = values_.refreshRate_ ? static_cast<S32>(values_.refreshRate_) : graphics->GetRefreshRate();
+
+	if (graphics->GetVSync() == values_.vsync_ && graphics->GetTripleBuffer() == values_.tripleBuffer_ &&
+		graphics->GetCurrentMonitor() == monitor && graphics->GetRefreshRate() == refreshRate)
+		return true;
+
+	graphics->SetMode(graphics->GetWidth(), graphics->GetHeight(), graphics->GetFullscreen(), graphics->GetBorderless(),
+		graphics->GetResizable(), graphics->GetHighDPI(), values_.vsync_, values_.tripleBuffer_, graphics->GetMultiSample(),
+		monitor, refreshRate);
+
+	return true;
+}
+
+void Configuration::ApplyWorkerThreads()
+{
+	WorkQueue* workQueue = GetSubsystem<WorkQueue>();
+	if (!workQueue)
+		return;
+
+	U32 threads = GetWorkerThreads();
+	if (!workQueue->GetNumThreads())
+	{
+		if (threads)
+			workQueue->CreateThreads(threads);
+	}
+	else if (workQueue->GetNumThreads() != threads)
+	{
+		URHO3D_LOGINFOF("Running %u worker threads, %u take effect after a restart", workQueue->GetNumThreads(), threads);
+	}
+}
+
+U32 Configuration::GetWorkerThreads() const
+{
+	U32 maxThreads = GetMaxWorkerThreads();
+	return values_.threads_ ? Min(values_.threads_, maxThreads) : maxThreads;
+}
+
+U32 Configuration::GetMaxWorkerThreads()
+{
+	U32 cpus = GetNumPhysicalCPUs();
+	return cpus > 1 ? cpus - 1 : 0;
+}
+
+U32 Configuration::GetTaskBatchSize(U32 itemCount) const
+{
+	if (values_.taskBatchSize_)
+		return values_.taskBatchSize_;
+
+	WorkQueue* workQueue = GetSubsystem<WorkQueue>();
+	U32 threads = (workQueue ? workQueue->GetNumThreads() : 0) + 1;
+	return Max((itemCount + threads - 1) / threads, 1u);
+}
+
+/// Forwards E_CONFIGCHANGED to the wrapped handler only when the commit touches the subscribed masks.
+class ConfigChangeHandler : public EventHandler
+{
+public:
+	ConfigChangeHandler(EventHandler* handler, Configuration::ParameterMask parameters, const Configuration::ActionMask& actions)
+		: EventHandler(handler->GetReceiver(), handler->GetUserData())
+		, handler_(handler)
+		, parameters_(parameters)
+		, actions_(actions)
+	{
+	}
+
+	void Invoke(VariantMap& eventData) override
+	{
+		using namespace ConfigChanged;
+
+		const Configuration::ActionMask& actions = *static_cast<const Configuration::ActionMask*>(eventData[P_ACTIONS].GetVoidPtr());
+		if ((eventData[P_PARAMETERS].GetUInt() & parameters_) || (actions & actions_).any())
+		{
+			handler_->SetSenderAndEventType(sender_, eventType_);
+			handler_->Invoke(eventData);
+		}
+	}
+
+	EventHandler* Clone() const override
+	{
+		return new ConfigChangeHandler(handler_->Clone(), parameters_, actions_);
+	}
+
+private:
+	std::unique_ptr<EventHandler> handler_;
+	Configuration::ParameterMask  parameters_;
+	Configuration::ActionMask     actions_;
+};
+
+void Configuration::SubscribeToChanges(Object* receiver, ParameterMask parameters, const ActionMask& actions, EventHandler* handler)
+{
+	// replaces an earlier subscription of the same receiver
+	receiver->SubscribeToEvent(this, E_CONFIGCHANGED, new ConfigChangeHandler(handler, parameters, actions));
+}
+
+void Configuration::UnsubscribeFromChanges(Object* receiver)
+{
+	receiver->UnsubscribeFromEvent(this, E_CONFIGCHANGED);
+}
+
+void Configuration::NotifyChanges(ParameterMask parameters, ActionMask actions)
+{
+	using namespace ConfigChanged;
+
+	VariantMap& eventData = GetEventDataMap();
+	eventData[P_PARAMETERS] = parameters;
+	eventData[P_ACTIONS] = &actions;
+	SendEvent(E_CONFIGCHANGED, eventData);
+}
+
+void Configuration::Save()
+{
+	TRACE_ZONE(ConfigSave);
+
+	Commit();
+
+	// nothing changed since the last save
+	if (saveRequested_ || (!dirtyParameters_ && dirtyActions_.none() && !jsonChanged_))
+		return;
+
+	saveRequested_ = true;
+	saveTimer_.Reset();
+}
+
+void Configuration::Flush()
+{
+	if (saveRequested_)
+		DispatchSave();
+
+	// WorkQueue may already be gone during Context teardown, then its queued items never run
+	if (workQueue_)
+		workQueue_->Complete(M_MAX_UNSIGNED);
+
+	WritePendingSaves();
+}
+
+void Configuration::DispatchSave()
+{
+	TRACE_ZONE(ConfigDispatchSave);
+
+	saveRequested_ = false;
+
+	if (jsonIncomplete_)
+	{
+		dirtyParameters_ = ALL_PARAMETERS;
+		dirtyActions_ = ALL_ACTIONS;
+		jsonIncomplete_ = false;
+	}
+
+	SyncParametersToJson();
+	SyncActionsToJson();
+	jsonChanged_ = false;
+
+	// actions left dirty keep their previous JSON in the file
+	fileValues_ = values_;
+	for (U32 action = 0; action < ACTIONS_COUNT; action++)
+	{
+		if (dirtyActions_[action])
+			continue;
+
+		GameInputActions inputAction = static_cast<GameInputActions>(action);
+		for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION; unitNumber++)
+			fileBindings_.Set(inputAction, unitNumber, userActionBindings_.Get(inputAction, unitNumber));
+	}
+
+	String content = jsonFile_.ToString();
+
+	// keys outside the schema are only kept by the JSON path, so such configs are not cached
+	VectorBuffer cachePayload;
+	if (!jsonHasUnknownKeys_)
+	{
+		ParsedConfig saved;
+		saved.values_ = values_;
+		saved.bindings_ = userActionBindings_;
+		saved.foundParameters_ = ALL_PARAMETERS;
+		saved.hasControls_ = true;
+		WriteCachePayload(cachePayload, saved);
+	}
+
+	bool queueWork = false;
+	{
+		MutexLock lock(saveMutex_);
+		pendingSaveContent_ = content;
+		pendingSaveCache_ = cachePayload.GetBuffer();
+		pendingSaveGeneration_++;
+
+		if (!saveWorkQueued_)
+		{
+			saveWorkQueued_ = true;
+			queueWork = true;
+		}
+	}
+
+	if (!queueWork)
+		return;
+
+	if (!workQueue_)
+	{
+		WritePendingSaves();
+		return;
+	}
+
+	SharedPtr<WorkItem> item = workQueue_->GetFreeItem();
+	item->workFunction_ = SaveWork;
+	item->aux_ = this;
+	// Flush() completes only items of this priority
+	item->priority_ = M_MAX_UNSIGNED;
+	workQueue_->AddWorkItem(item);
+}
+
+void Configuration::SaveWork(const WorkItem* item, unsigned threadIndex)
+{
+	static_cast<Configuration*>(item->aux_)->WritePendingSaves();
+}
+
+void Configuration::WritePendingSaves()
+{
+	TRACE_SCOPE(ConfigWriteSave);
+
+	for (;;)
+	{
+		String content;
+		PODVector<unsigned char> cachePayload;
+		U32 generation;
+		{
+			MutexLock lock(saveMutex_);
+			if (writtenSaveGeneration_ >= pendingSaveGeneration_)
+			{
+				saveWorkQueued_ = false;
+				return;
+			}
+
+			content = pendingSaveContent_;
+			cachePayload = pendingSaveCache_;
+			generation = pendingSaveGeneration_;
+			savedContentChecksum_ = ContentChecksum(content.CString(), content.Length());
+		}
+
+		// a config without cache payload leaves a stale cache behind, which fails validation on the next start
+		if (WriteConfigFile(content))
+			WriteCacheFile(content.CString(), content.Length(), cachePayload);
+
+		MutexLock lock(saveMutex_);
+		writtenSaveGeneration_ = generation;
+	}
+}
+
+bool Configuration::WriteConfigFile(const String& content)
+{
+	if (!fileSystem_)
+		return false;
+
+	String tempFileName = configFileName_ + ".tmp";
+	{
+		File configFile(context_, tempFileName, FILE_WRITE);
+		if (!configFile.IsOpen() || configFile.Write(content.CString(), content.Length()) != content.Length())
+		{
+			URHO3D_LOGERROR("Failed to write " + tempFileName);
+			return false;
+		}
+	}
+
+	// rename does not replace an existing file on every platform
+	if (!fileSystem_->Rename(tempFileName, configFileName_))
+	{
+		fileSystem_->Delete(configFileName_);
+		if (!fileSystem_->Rename(tempFileName, configFileName_))
+		{
+			URHO3D_LOGERROR("Failed to replace " + configFileName_);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Configuration::StartReload()
+{
+	reloadRequested_ = false;
+	reloadInput_ = GetSubsystem<Input>();
+
+	if (!workQueue_)
+	{
+		ParseReload();
+		ApplyReload();
+		return;
+	}
+
+	reloadItem_ = workQueue_->GetFreeItem();
+	reloadItem_->workFunction_ = ReloadWork;
+	reloadItem_->aux_ = this;
+	reloadItem_->sendEvent_ = true;
+	// Flush() completes only items of this priority
+	reloadItem_->priority_ = M_MAX_UNSIGNED;
+	workQueue_->AddWorkItem(reloadItem_);
+}
+
+void Configuration::ReloadWork(const WorkItem* item, unsigned threadIndex)
+{
+	static_cast<Configuration*>(item->aux_)->ParseReload();
+}
+
+void Configuration::ParseReload()
+{
+	TRACE_SCOPE(ConfigParseReload);
+
+	ReloadResult& result = reloadResult_;
+	result.loaded_ = false;
+	result.ownSave_ = false;
+	result.parsed_ = ParsedConfig();
+	result.parsed_.values_ = DefaultParameterValues();
+	result.parsed_.bindings_ = DefaultActionBindings;
+
+	File configFile(context_, configFileName_, FILE_READ);
+	if (!configFile.IsOpen())
+		return;
+
+	result.content_.Resize(configFile.GetSize() + 1);
+	U32 size = configFile.Read(&result.content_[0], configFile.GetSize());
+	result.content_[size] = '\0';
+
+	U32 checksum = ContentChecksum(&result.content_[0], size);
+	{
+		MutexLock lock(saveMutex_);
+		if (checksum == savedContentChecksum_)
+		{
+			result.ownSave_ = true;
+			return;
+		}
+	}
+
+	result.loaded_ = ParseConfig(&result.content_[0], reloadInput_, result.parsed_);
+}
+
+void Configuration::ApplyReload()
+{
+	TRACE_ZONE(ConfigApplyReload);
+
+	if (reloadResult_.ownSave_)
+		return;
+
+	// editors often write in several steps, the last change notification brings the complete file
+	if (!reloadResult_.loaded_)
+	{
+		URHO3D_LOGWARNING("Failed to reload " + configFileName_ + ", keeping the current configuration");
+		return;
+	}
+
+	const ParsedConfig& parsed = reloadResult_.parsed_;
+
+	// only keys edited in the file are applied, unsaved local changes of the others stay pending
+	ParameterMask editedParameters = 0;
+	ParameterMask changedParameters = 0;
+#define CONFIG_RELOAD_PARAMETER(id, name, type, defaultValue) \
+	if (!(fileValues_.name##_ == parsed.values_.name##_)) \
+	{ \
+		fileValues_.name##_ = parsed.values_.name##_; \
+		editedParameters |= ParameterBit(ConfigParameter::id); \
+		if (!(values_.name##_ == parsed.values_.name##_)) \
+		{ \
+			values_.name##_ = parsed.values_.name##_; \
+			changedParameters |= ParameterBit(ConfigParameter::id); \
+		} \
+	}
+	CONFIG_PARAMETERS(CONFIG_RELOAD_PARAMETER)
+#undef CONFIG_RELOAD_PARAMETER
+
+	// bindings are tracked per action, an edited action takes all of its slots from the file
+	ActionMask editedActions;
+	ActionMask changedActions;
+	for (U32 action = 0; action < ACTIONS_COUNT; action++)
+	{
+		GameInputActions inputAction = static_cast<GameInputActions>(action);
+
+		bool edited = false;
+		for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION && !edited; unitNumber++)
+			edited = !(fileBindings_.Get(inputAction, unitNumber) == parsed.bindings_.Get(inputAction, unitNumber));
+
+		if (!edited)
+			continue;
+
+		editedActions.set(action);
+		for (U32 unitNumber = 0; unitNumber < ACTION_UNITS_PER_ACTION; unitNumber++)
+		{
+			ActionUnit unit = parsed.bindings_.Get(inputAction, unitNumber);
+			fileBindings_.Set(inputAction, unitNumber, unit);
+			if (userActionBindings_.Get(inputAction, unitNumber) == unit)
+				continue;
+
+			userActionBindings_.Set(inputAction, unitNumber, unit);
+			changedActions.set(action);
+		}
+	}
+
+	if (!editedParameters && editedActions.none() && !parsed.hasUnknownKeys_ && !jsonHasUnknownKeys_)
+		return;
+
+	// the file holds the edited keys now, an unsaved local value of the same key is replaced
+	dirtyParameters_ &= ~editedParameters;
+	dirtyActions_ &= ~editedActions;
+
+	jsonFile_.GetRoot() = JSONValue();
+	jsonIncomplete_ = true;
+	jsonHasUnknownKeys_ = parsed.hasUnknownKeys_;
+	if (parsed.hasUnknownKeys_ && jsonFile_.FromString(&reloadResult_.content_[0]))
+		jsonIncomplete_ = false;
+
+	if (changedActions.any())
+		RebuildActionIndex();
+
+	if (changedParameters & ParameterBit(ConfigParameter::Trace))
+		Tracer::Enable(values_.trace_);
+
+	URHO3D_LOGINFOF("Reloaded %s: %u parameters and %u actions changed", configFileName_.CString(),
+		CountSetBits(changedParameters), static_cast<U32>(changedActions.count()));
+
+	uncommittedParameters_ |= changedParameters;
+	uncommittedActions_ |= changedActions;
+	Commit();
+}
+
+/// Parse a binding slot name ("0", "1", ...) without converting through String.
+static bool ParseActionUnitNumber(const char* str, U32 length, U32& unitNumber)
+{
+	if (!length)
+		return false;
+
+	unitNumber = 0;
+	for (U32 i = 0; i < length; i++)
+	{
+		if (str[i] < '0' || str[i] > '9')
+			return false;
+
+		unitNumber = unitNumber * 10 + (str[i] - '0');
+		if (unitNumber >= Configuration::ACTION_UNITS_PER_ACTION)
+			return false;
+	}
+
+	return true;
+}
+
+struct JSONStringRef
+{
+	const char* str_;
+	U32         length_;
+};
+
+// values of a mismatching JSON type are rejected, the default is used and the file keeps the value
+static bool AssignScalar(U32& value, double number) { if (number < 0.0) return false; value = static_cast<U32>(number); return true; }
+static bool AssignScalar(F32& value, double number) { value = static_cast<F32>(number); return true; }
+static bool AssignScalar(bool& value, bool boolean) { value = boolean; return true; }
+static bool AssignScalar(String& value, const JSONStringRef& string) { value = String(string.str_, string.length_); return true; }
+template <class T, class V>
+static bool AssignScalar(T& value, const V& json) { return false; }
+
+/**
+ * SAX handler filling ParsedConfig in one pass over the text.
+ * Object levels: 1 root parameters, 2 "controls" or a legacy parameter, 3 action, 4 binding slot.
+ * Values that are not part of the schema are skipped and flagged for DOM round-trip,
+ * as are parameter values that cannot be read.
+ */
+class ConfigReader : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, ConfigReader>
+{
+public:
+	ConfigReader(Input* input, Configuration::ParsedConfig& result)
+		: input_(input)
+		, result_(result)
+	{ }
+
+	bool Null()                                                  { OnValue(); return true; }
+	bool Bool(bool value)                                        { if (OnValue()) Assign(value); return true; }
+	bool Int(int value)                                          { if (OnValue()) Assign(static_cast<double>(value)); return true; }
+	bool Uint(unsigned value)                                    { if (OnValue()) Assign(static_cast<double>(value)); return true; }
+	bool Int64(int64_t value)                                    { if (OnValue()) Assign(static_cast<double>(value)); return true; }
+	bool Uint64(uint64_t value)                                  { if (OnValue()) Assign(static_cast<double>(value)); return true; }
+	bool Double(double value)                                    { if (OnValue()) Assign(value); return true; }
+	bool String(const char* str, rapidjson::SizeType length, bool copy)
+	{
+		if (OnValue())
+			Assign(JSONStringRef{ str, length });
+
+		return true;
+	}
+
+	bool StartObject()
+	{
+		if (!BeginContainer())
+			return true;
+
+		switch (depth_)
+		{
+			case 0:
+				break;
+			case 1:
+				if (!controlsKey_)
+				{
+					// JSONValue::SetVariant layout written by older versions
+					legacyParameter_ = true;
+					legacyValueRead_ = false;
+					break;
+				}
+				result_.hasControls_ = true;
+				break;
+			case 2:
+				if (legacyParameter_)
+				{
+					skipDepth_ = 1;
+					return true;
+				}
+				result_.foundActions_ |= Configuration::ActionBit(action_);
+				break;
+			case 3:
+				deviceName_.Clear();
+				keyName_.Clear();
+				break;
+			default:
+				skipDepth_ = 1;
+				return true;
+		}
+
+		depth_++;
+		return true;
+	}
+
+	bool EndObject(rapidjson::SizeType memberCount)
+	{
+		if (skipDepth_)
+		{
+			skipDepth_--;
+			return true;
+		}
+
+		if (depth_ == 4)
+			ResolveActionUnit();
+		else if (depth_ == 2 && legacyParameter_)
+			EndLegacyParameter();
+
+		depth_--;
+		return true;
+	}
+
+	bool StartArray()
+	{
+		if (!BeginContainer())
+			return true;
+
+		if (depth_ == 1 && !controlsKey_)
+			KeepUnreadable();
+
+		skipDepth_ = 1;
+		return true;
+	}
+
+	bool EndArray(rapidjson::SizeType elementCount)
+	{
+		skipDepth_--;
+		return true;
+	}
+
+	bool Key(const char* str, rapidjson::SizeType length, bool copy)
+	{
+		if (skipDepth_)
+			return true;
+
+		bool known = true;
+		switch (depth_)
+		{
+			case 1:
+				controlsKey_ = (length == 8 && memcmp(str, "controls", 8) == 0);
+				parameter_ = Configuration::ParameterFromName(str, length);
+				known = controlsKey_ || parameter_ != Configuration::ConfigParameter::Count;
+				break;
+			case 2:
+				if (legacyParameter_)
+				{
+					// the type is implied by the schema
+					skipValue_ = !(length == 5 && memcmp(str, "value", 5) == 0);
+					return true;
+				}
+				action_ = Configuration::ActionFromName(str, length);
+				known = action_ != Configuration::GameInputActions::Count;
+				break;
+			case 3:
+				known = ParseActionUnitNumber(str, length, unitNumber_);
+				break;
+			case 4:
+				field_ = Field::None;
+				if (length == 6 && memcmp(str, "device", 6) == 0)
+					field_ = Field::Device;
+				else if (length == 3 && memcmp(str, "key", 3) == 0)
+					field_ = Field::Key;
+				known = field_ != Field::None;
+				break;
+		}
+
+		if (!known)
+		{
+			result_.hasUnknownKeys_ = true;
+			skipValue_ = true;
+		}
+
+		return true;
+	}
+
+private:
+	enum class Field
+	{
+		None,
+		Device,
+		Key
+	};
+
+	/// Returns false for values inside or at a skipped key.
+	bool OnValue()
+	{
+		if (skipDepth_)
+			return false;
+
+		if (skipValue_)
+		{
+			skipValue_ = false;
+			return false;
+		}
+
+		return true;
+	}
+
+	/// Returns false when the container is skipped as a whole.
+	bool BeginContainer()
+	{
+		if (skipDepth_)
+		{
+			skipDepth_++;
+			return false;
+		}
+
+		if (skipValue_)
+		{
+			skipValue_ = false;
+			skipDepth_ = 1;
+			return false;
+		}
+
+		return true;
+	}
+
+	template <class V>
+	void Assign(const V& value)
+	{
+		if ((depth_ == 1 && !controlsKey_) || (depth_ == 2 && legacyParameter_))
+			AssignParameter(value);
+		else if (depth_ == 4)
+			AssignField(value);
+	}
+
+	template <class V>
+	void AssignParameter(const V& value)
+	{
+		bool assigned = false;
+		switch (parameter_)
+		{
+#define CONFIG_PARAMETER_ASSIGN(id, name, type, defaultValue) \
+			case Configuration::ConfigParameter::id: \
+				assigned = AssignScalar(result_.values_.name##_, value); \
+				break;
+			CONFIG_PARAMETERS(CONFIG_PARAMETER_ASSIGN)
+#undef CONFIG_PARAMETER_ASSIGN
+			default:
+				break;
+		}
+
+		if (!assigned)
+		{
+			KeepUnreadable();
+			return;
+		}
+
+		result_.foundParameters_ |= Configuration::ParameterBit(parameter_);
+		if (legacyParameter_)
+			legacyValueRead_ = true;
+	}
+
+	/// The key counts as found so that saves do not overwrite the user's value with the default.
+	void KeepUnreadable()
+	{
+		result_.foundParameters_ |= Configuration::ParameterBit(parameter_);
+		result_.hasUnknownKeys_ = true;
+	}
+
+	void EndLegacyParameter()
+	{
+		legacyParameter_ = false;
+		if (legacyValueRead_)
+			result_.legacyParameters_ |= Configuration::ParameterBit(parameter_);
+		else
+			KeepUnreadable();
+	}
+
+	void AssignField(const JSONStringRef& value)
+	{
+		if (field_ == Field::Device)
+			AssignScalar(deviceName_, value);
+		else if (field_ == Field::Key)
+			AssignScalar(keyName_, value);
+	}
+
+	template <class V>
+	void AssignField(const V& value) { }
+
+	void ResolveActionUnit()
+	{
+		Configuration::InputDeviceType deviceType = Configuration::DeviceTypeFromName(deviceName_);
+
+		S32 key = KEY_UNKNOWN;
+		if (deviceType == Configuration::InputDeviceType::Keyboard)
+		{
+			// without Input keyboard names cannot be resolved, keep the default binding
+			if (!input_)
+				return;
+
+			key = input_->GetKeyFromName(keyName_);
+		}
+		else if (deviceType == Configuration::InputDeviceType::Mouse)
+			key = Configuration::MouseKeyFromName(keyName_);
+
+		result_.bindings_.Set(action_, unitNumber_, Configuration::ActionUnit(deviceType, key));
+	}
+
+	Input*                         input_;
+	Configuration::ParsedConfig&   result_;
+
+	U32  depth_       = 0;
+	U32  skipDepth_   = 0;
+	bool skipValue_   = false;
+
+	bool                             controlsKey_     = false;
+	bool                             legacyParameter_ = false;
+	bool                             legacyValueRead_ = false;
+	Configuration::ConfigParameter   parameter_       = Configuration::ConfigParameter::Count;
+	Configuration::GameInputActions  action_          = Configuration::GameInputActions::Count;
+	U32                              unitNumber_      = 0;
+	Field                            field_           = Field::None;
+	Urho3D::String                   deviceName_;
+	Urho3D::String                   keyName_;
+};
+
+bool Configuration::ParseConfig(const char* json, Input* input, ParsedConfig& result)
+{
+	ConfigReader handler(input, result);
+	rapidjson::Reader reader;
+	rapidjson::StringStream stream(json);
+
+	if (!reader.Parse<rapidjson::kParseDefaultFlags>(stream, handler))
+	{
+		URHO3D_LOGERROR("Could not parse config JSON at offset " + String(static_cast<U32>(reader.GetErrorOffset())));
+		return false;
+	}
+
+	return true;
+}
+
+void Configuration::SaveUserActionMap()
+{
+	dirtyActions_ = ALL_ACTIONS;
+}
+
+void Configuration::SyncActionsToJson()
+{
+	if (dirtyActions_.none())
+		return;
+
+	Input* input = GetSubsystem<Input>();
+	JSONValue& controlsJson = jsonFile_.GetRoot()["controls"];
+	ActionMask unresolvedActions;
+	for (U32 action = 0; action < ACTIONS_COUNT; action++)
+	{
+		if (!dirtyActions_[action])
+			continue;
+
+		const char* actionName = StringFromEnumActions(static_cast<GameInputActions>(action));
+
+		JSONValue actionJson;
+		bool resolved = true;
+		for (U32 actionUnitNumber = 0; actionUnitNumber < ACTION_UNITS_PER_ACTION && resolved; actionUnitNumber++)
+		{
+			InputDeviceType deviceType = userActionBindings_.deviceTypes_[actionUnitNumber][action];
+			if (deviceType == InputDeviceType::No_Device)
+				continue;
+
+			const String& keyName = StringFromKey(deviceType, userActionBindings_.keys_[actionUnitNumber][action]);
+			resolved = !keyName.Empty() || input || deviceType != InputDeviceType::Keyboard;
+
+			JSONValue& actionUnitJson = actionJson[String(actionUnitNumber)];
+			actionUnitJson["device"] = StringFromDeviceType(deviceType);
+			actionUnitJson["key"] = keyName;
+		}
+
+		// without a name the file keeps the previous binding, the action is written by a later save
+		if (!resolved)
+			unresolvedActions.set(action);
+		else if (actionJson.IsNull())
+			controlsJson.Erase(actionName);
+		else
+			controlsJson[actionName] = actionJson;
+	}
+
+	dirtyActions_ = unresolvedActions;
+}
+
+void Configuration::SyncParametersToJson()
+{
+	if (!dirtyParameters_)
+		return;
+
+	JSONValue& root = jsonFile_.GetRoot();
+#define CONFIG_PARAMETER_STORE(id, name, type, defaultValue) \
+	if (dirtyParameters_ & ParameterBit(ConfigParameter::id)) \
+		root[#name] = values_.name##_;
+	CONFIG_PARAMETERS(CONFIG_PARAMETER_STORE)
+#undef CONFIG_PARAMETER_STORE
+
+	dirtyParameters_ = 0;
+}
+
+void Configuration::SetValue(const String& name, Variant value)
+{
+	switch (ParameterFromName(name))
+	{
+#define CONFIG_PARAMETER_SET(id, name, type, defaultValue) \
+		case ConfigParameter::id: \
+		{ \
+			type typedValue; \
+			ReadVariant(value, typedValue); \
+			Set(ConfigKeys::id, typedValue); \
+			return; \
+		}
+		CONFIG_PARAMETERS(CONFIG_PARAMETER_SET)
+#undef CONFIG_PARAMETER_SET
+		default:
+			jsonFile_.GetRoot()[name].SetVariant(value);
+			jsonChanged_ = true;
+			jsonHasUnknownKeys_ = true;
+	}
+}
+
+Variant Configuration::GetValue(const String& name) const
+{
+	switch (ParameterFromName(name))
+	{
+#define CONFIG_PARAMETER_GET(id, name, type, defaultValue) \
+		case ConfigParameter::id: \
+			return Variant(values_.name##_);
+		CONFIG_PARAMETERS(CONFIG_PARAMETER_GET)
+#undef CONFIG_PARAMETER_GET
+		default:
+			return jsonFile_.GetRoot()[name].GetVariant();
+	}
+}
+
+Configuration::ActionMask Configuration::GetActionsBoundTo(InputDeviceType device, S32 key) const
+{
+	auto indexIt = actionIndex_.find(ActionUnit(device, key));
+	if (indexIt == actionIndex_.end())
+		return ActionMask();
+
+	return indexIt->second;
+}
+
+Configuration::ActionUnit Configuration::GetActionUnit(GameInputActions action, U32 unitNumber) const
+{
+	if (action >= GameInputActions::Count || unitNumber >= ACTION_UNITS_PER_ACTION)
+		return ActionUnit();
+
+	return userActionBindings_.Get(action, unitNumber);
+}
+
+const String& Configuration::GetActionKeyName(GameInputActions action, U32 unitNumber) const
+{
+	ActionUnit unit = GetActionUnit(action, unitNumber);
+	if (unit.deviceType_ == InputDeviceType::No_Device)
+		return String::EMPTY;
+
+	return StringFromKey(unit.deviceType_, unit.key_);
+}
+
+Configuration::ActionMask Configuration::SetActionKey(GameInputActions action, InputDeviceType device, S32 key, U32 unitNumber)
+{
+	if (action >= GameInputActions::Count || unitNumber >= ACTION_UNITS_PER_ACTION)
+	{
+		URHO3D_LOGERROR("Invalid action binding slot " + String(unitNumber));
+		return ActionMask();
+	}
+
+	ActionUnit unit(device, key);
+	ActionMask actionBit = ActionBit(action);
+
+	ActionMask conflicts = GetActionsBoundTo(device, key) & ~actionBit;
+	if (conflicts.any())
+		URHO3D_LOGWARNING("Key " + StringFromKey(device, key) + " bound to " + StringFromEnumActions(action) + " is also used by other actions");
+
+	ActionUnit oldUnit = userActionBindings_.Get(action, unitNumber);
+	if (oldUnit == unit)
+		return conflicts;
+
+	userActionBindings_.Set(action, unitNumber, unit);
+
+	// patch the index for this slot only
+	if (oldUnit.deviceType_ != InputDeviceType::No_Device)
+	{
+		bool stillBound = false;
+		for (U32 otherUnit = 0; otherUnit < ACTION_UNITS_PER_ACTION && !stillBound; otherUnit++)
+			stillBound = userActionBindings_.Get(action, otherUnit) == oldUnit;
+
+		auto indexIt = actionIndex_.find(oldUnit);
+		if (!stillBound && indexIt != actionIndex_.end())
+		{
+			indexIt->second &= ~actionBit;
+			if (indexIt->second.none())
+				actionIndex_.erase(indexIt);
+		}
+	}
+
+	if (device != InputDeviceType::No_Device)
+	{
+		actionIndex_[unit] |= actionBit;
+		StringFromKey(device, key);
+	}
+
+	if (Input* input = GetSubsystem<Input>())
+		ResyncHeldAction(input, static_cast<U32>(action), GetInputTime());
+
+	dirtyActions_ |= actionBit;
+	uncommittedActions_ |= actionBit;
+
+	return conflicts;
+}
@@ -1,52 +1,91 @@
 #pragma once
 
+#include <Urho3D/Core/Mutex.h>
 #include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/FileWatcher.h>
 #include <Urho3D/Input/Input.h>
 #include <Urho3D/Resource/JSONFile.h>
 
 #include "utility/simpleTypes.h"
 
+#include <atomic>
+#include <bitset>
 #include <unordered_map>
-#include <map>
 
 using namespace Urho3D;
 
+/// Bindable actions in GameInputActions order. Adding an action is one line here plus its default binding.
+#define CONFIG_INPUT_ACTIONS(X) \
+	X(MoveForward) \
+	X(MoveBackward) \
+	X(MoveLeft) \
+	X(MoveRight) \
+	X(FirePrimary) \
+	X(FireSecondary) \
+	X(FireThird) \
+	X(FireUltimate)
+
+/// Configuration changed, sent once per commit to receivers interested in one of the changes.
+URHO3D_EVENT(E_CONFIGCHANGED, ConfigChanged)
+{
+	URHO3D_PARAM(P_PARAMETERS, Parameters);     // Configuration::ParameterMask
+	URHO3D_PARAM(P_ACTIONS, Actions);           // const Configuration::ActionMask*, valid during the event
+}
+
+/**
+ * Persistent parameters: X(Id, jsonName, type, default).
+ * Defaults are constants defined in config.cpp, the only place the last column is expanded.
+ */
+#define CONFIG_PARAMETERS(X) \
+	X(Width,           width,           U32,    DEFAULT_WIDTH) \
+	X(Height,          height,          U32,    DEFAULT_HEIGHT) \
+	X(Fullscreen,      fullscreen,      bool,   DEFAULT_FULLSCREEN) \
+	X(Borderless,      borderless,      bool,   DEFAULT_BORDERLESS) \
+	X(Sound,           sound,           F32,    DEFAULT_SOUND_VOLUME) \
+	X(Address,         address,         String, DefaultServerAddress) \
+	X(Port,            port,            U32,    DEFAULT_SERVER_PORT) \
+	X(Lang,            lang,            String, DefaultLang) \
+	X(VSync,           vsync,           bool,   DEFAULT_VSYNC) \
+	X(TripleBuffer,    tripleBuffer,    bool,   DEFAULT_TRIPLE_BUFFER) \
+	X(Monitor,         monitor,         U32,    DEFAULT_MONITOR) \
+	X(RefreshRate,     refreshRate,     U32,    DEFAULT_REFRESH_RATE) \
+	X(MaxFps,          maxFps,          U32,    DEFAULT_MAX_FPS) \
+	X(MaxInactiveFps,  maxInactiveFps,  U32,    DEFAULT_MAX_INACTIVE_FPS) \
+	X(Trace,           trace,           bool,   DEFAULT_TRACE) \
+	X(PerfOverlay,     perfOverlay,     bool,   DEFAULT_PERF_OVERLAY) \
+	X(Threads,         threads,         U32,    DEFAULT_THREADS) \
+	X(TaskBatchSize,   taskBatchSize,   U32,    DEFAULT_TASK_BATCH_SIZE)
+
 class Configuration : public Object
 {
 	URHO3D_OBJECT(Configuration, Object);
 
 public:
 
-	struct EnumClassHash
-	{
-		template <typename T>
-		std::size_t operator()(T t) const
-		{
-			return static_cast<U32>(t);
-		}
-	};
-
 	enum class GameInputActions : U32
 	{
-		MoveForward = 0,
-		MoveBackward,
-		MoveLeft,
-		MoveRight,
-		FirePrimary,
-		FireSecondary,
-		FireThird,
-		FireUltimate,
+#define CONFIG_ACTION_ENUM(name) name,
+		CONFIG_INPUT_ACTIONS(CONFIG_ACTION_ENUM)
+#undef CONFIG_ACTION_ENUM
 		Count
 	};
 
+	/// No_Device is zero so that zero-initialized binding slots are empty.
 	enum class InputDeviceType
 	{
-		No_Device = -1,
-		Mouse = 0,
+		No_Device = 0,
+		Mouse,
 		Keyboard,
 		Count
 	};
 
+	static const U32 ACTIONS_COUNT = static_cast<U32>(GameInputActions::Count);
+	/// Binding slots per action, slot 0 is the primary key.
+	static const U32 ACTION_UNITS_PER_ACTION = 2;
+
 	struct ActionUnit
 	{
 		InputDeviceType deviceType_ = InputDeviceType::No_Device;
@@ -58,43 +97,442 @@ public:
 			: deviceType_(deviceType)
 			, key_(key)
 		{ }
+
+		bool operator==(const ActionUnit& rhs) const
+		{
+			return deviceType_ == rhs.deviceType_ && key_ == rhs.key_;
+		}
+	};
+
+	struct ActionUnitHash
+	{
+		std::size_t operator()(const ActionUnit& unit) const
+		{
+			return (static_cast<U32>(unit.deviceType_) << 24) ^ static_cast<U32>(unit.key_);
+		}
 	};
 
-	using ActionsMap = std::unordered_map<GameInputActions, std::map<U32, ActionUnit>, EnumClassHash>;
-	static ActionsMap DefaultActionsMap;
+	/**
+	 * Flat binding table laid out slot-major: entry [unitNumber][action].
+	 * Slots not listed in an initializer stay zero, i.e. No_Device / KEY_UNKNOWN.
+	 */
+	struct ActionBindings
+	{
+		InputDeviceType deviceTypes_[ACTION_UNITS_PER_ACTION][ACTIONS_COUNT];
+		S32             keys_[ACTION_UNITS_PER_ACTION][ACTIONS_COUNT];
 
-	static String StringFromEnumActions(GameInputActions inputAction);
-	static String StringFromDeviceType(InputDeviceType deviceType);
+		ActionUnit Get(GameInputActions action, U32 unitNumber) const
+		{
+			return ActionUnit(deviceTypes_[unitNumber][static_cast<U32>(action)], keys_[unitNumber][static_cast<U32>(action)]);
+		}
 
-	static String MouseKeyName(S32 key);
+		void Set(GameInputActions action, U32 unitNumber, const ActionUnit& unit)
+		{
+			deviceTypes_[unitNumber][static_cast<U32>(action)] = unit.deviceType_;
+			keys_[unitNumber][static_cast<U32>(action)] = unit.key_;
+		}
+	};
+
+	static const ActionBindings DefaultActionBindings;
+
+	enum class ConfigParameter : U32
+	{
+#define CONFIG_PARAMETER_ENUM(id, name, type, defaultValue) id,
+		CONFIG_PARAMETERS(CONFIG_PARAMETER_ENUM)
+#undef CONFIG_PARAMETER_ENUM
+		Count
+	};
+
+	/// Typed storage of all parameters, one field per CONFIG_PARAMETERS entry.
+	struct ConfigValues
+	{
+#define CONFIG_PARAMETER_FIELD(id, name, type, defaultValue) type name##_;
+		CONFIG_PARAMETERS(CONFIG_PARAMETER_FIELD)
+#undef CONFIG_PARAMETER_FIELD
+	};
+
+	/// Handle to a parameter slot, see ConfigKeys.
+	template <class T>
+	struct Key
+	{
+		using ValueType = T;
+
+		ConfigParameter          parameter_;
+		T ConfigValues::*        member_;
+	};
+
+	/// Bit set of ConfigParameter.
+	using ParameterMask = U32;
+	static_assert(static_cast<U32>(ConfigParameter::Count) <= sizeof(ParameterMask) * 8, "ParameterMask is too narrow for ConfigParameter");
+
+	static const ParameterMask ALL_PARAMETERS = static_cast<ParameterMask>((1ull << static_cast<U32>(ConfigParameter::Count)) - 1);
+
+	static ParameterMask ParameterBit(ConfigParameter parameter) { return 1u << static_cast<U32>(parameter); }
+
+	static const char* StringFromParameter(ConfigParameter parameter);
+	/// ConfigParameter::Count when name is unknown.
+	static ConfigParameter ParameterFromName(const char* str, U32 length);
+	static ConfigParameter ParameterFromName(const String& name) { return ParameterFromName(name.CString(), name.Length()); }
+
+	/// Bit set of GameInputActions, bit index is the action value. It grows with CONFIG_INPUT_ACTIONS.
+	using ActionMask = std::bitset<ACTIONS_COUNT>;
+
+	static const ActionMask ALL_ACTIONS;
+
+	static ActionMask ActionBit(GameInputActions action) { return ActionMask().set(static_cast<U32>(action)); }
+
+	/// (device, key) -> actions bound to it
+	using ActionIndex = std::unordered_map<ActionUnit, ActionMask, ActionUnitHash>;
+
+	/// Action transition captured from raw input events.
+	struct ActionEvent
+	{
+		GameInputActions action_       = GameInputActions::Count;
+		bool             pressed_      = false;
+		/// microseconds, same time base as GetInputTime()
+		long long        time_         = 0;
+		/// for releases, how long the action was held in microseconds
+		long long        heldDuration_ = 0;
+	};
+
+	static const U32 ACTION_EVENT_QUEUE_SIZE = 64;
+
+	/// Name tables are constant, returned strings are never allocated. Unknown values give "".
+	static const char* StringFromEnumActions(GameInputActions inputAction);
+	static const char* StringFromDeviceType(InputDeviceType deviceType);
+	static const char* MouseKeyName(S32 key);
+
+	/// Reverse lookups, GameInputActions::Count / No_Device / 0 when name is unknown.
+	static GameInputActions ActionFromName(const char* str, U32 length);
+	static GameInputActions ActionFromName(const String& name) { return ActionFromName(name.CString(), name.Length()); }
+	static InputDeviceType DeviceTypeFromName(const String& name);
 	static S32 MouseKeyFromName(const String& name);
 
-	String StringFromKey(InputDeviceType device, S32 key) const;
+	/// Display name of a key, interned per (device, key). The reference stays valid for the lifetime of Configuration.
+	const String& StringFromKey(InputDeviceType device, S32 key) const;
+	/// Re-resolve interned key names in place, e.g. after a keyboard layout change.
+	void RefreshKeyLabels();
+
+	/// Bump when the binary cache format changes.
+	static const U32 CACHE_VERSION = 1;
+
+	/// Save() requests arriving within this window are written once.
+	static const U32 SAVE_COALESCE_MSEC = 500;
 
 	/// Construct.
 	Configuration(Context* context);
+	/// Destruct. Writes any pending save synchronously.
+	virtual ~Configuration();
+
+	/// Immutable copy of the committed configuration, shared with other threads.
+	struct Snapshot
+	{
+		ConfigValues   values_;
+		ActionBindings bindings_;
+		/// incremented on every commit
+		U32            revision_;
+		/// holders, plus one while the snapshot is published or retired
+		mutable std::atomic<U32> refs_{ 1 };
+	};
+
+	/// Holder of a snapshot reference, released on destruction.
+	class SnapshotRef
+	{
+	public:
+		SnapshotRef() = default;
+		explicit SnapshotRef(const Snapshot* snapshot) : snapshot_(snapshot) { }
+		SnapshotRef(SnapshotRef&& rhs) : snapshot_(rhs.snapshot_) { rhs.snapshot_ = nullptr; }
+		SnapshotRef(const SnapshotRef&) = delete;
+		~SnapshotRef() { ReleaseSnapshot(snapshot_); }
+
+		SnapshotRef& operator=(SnapshotRef&& rhs) { std::swap(snapshot_, rhs.snapshot_); return *this; }
+		SnapshotRef& operator=(const SnapshotRef&) = delete;
+
+		const Snapshot* operator->() const { return snapshot_; }
+		const Snapshot& operator*() const { return *snapshot_; }
+		const Snapshot* Get() const { return snapshot_; }
+		explicit operator bool() const { return snapshot_ != nullptr; }
+
+	private:
+		const Snapshot* snapshot_ = nullptr;
+	};
+
+	/**
+	 * Current snapshot, callable from any thread and lock-free. The pointer is swapped on Commit(),
+	 * a replaced snapshot is freed once no reader can still reach it and its last holder released it.
+	 */
+	SnapshotRef GetSnapshot() const;
+	/// Publish changes since the last commit as a new snapshot and notify subscribers. Runs at the start of every frame and on Save().
+	void Commit();
+
+	/// Push frame pacing parameters to Engine. Runs after Load() and whenever they change.
+	void ApplyEngineSettings();
+	/// Display settings for Engine::Initialize(), so the window opens in the stored mode. Call after Load().
+	void FillEngineParameters(VariantMap& engineParameters) const;
+	/**
+	 * Switch the open window to the stored vsync, triple buffer, monitor and refresh rate when they differ.
+	 * Runs on the first frame after Load(), for windows opened without FillEngineParameters(). Returns false
+	 * while there is no window.
+	 */
+	bool ApplyDisplaySettings();
+	/**
+	 * Create the WorkQueue threads, runs at the end of Load(). Threads can be created only once, so the
+	 * setting takes effect only when the config loads before Engine::Initialize() or with EP_WORKER_THREADS off.
+	 */
+	void ApplyWorkerThreads();
+
+	/// Threads setting with 0 resolved to GetMaxWorkerThreads(), larger values are clamped to it.
+	U32 GetWorkerThreads() const;
+	/// One worker thread per physical CPU besides the main thread.
+	static U32 GetMaxWorkerThreads();
+	/// Items per work item when itemCount items are split across the worker threads and the main thread.
+	U32 GetTaskBatchSize(U32 itemCount) const;
+
+	/**
+	 * Subscribe receiver's handler to E_CONFIGCHANGED from this object. The event is sent through
+	 * SendEvent as usual, the handler runs only for commits that change one of the given parameters or actions.
+	 */
+	void SubscribeToChanges(Object* receiver, ParameterMask parameters, const ActionMask& actions, EventHandler* handler);
+	void UnsubscribeFromChanges(Object* receiver);
+
+	/// Result of parsing a config file against the CONFIG_PARAMETERS / controls schema.
+	struct ParsedConfig
+	{
+		ConfigValues   values_;
+		ActionBindings bindings_;
+		ParameterMask  foundParameters_  = 0;
+		ActionMask     foundActions_     = 0;
+		/// found in the {"type", "value"} layout of older versions, rewritten as scalars on the next save
+		ParameterMask  legacyParameters_ = 0;
+		bool           hasControls_      = false;
+		/// keys outside the schema were skipped, the DOM is needed to keep them
+		bool           hasUnknownKeys_   = false;
+	};
+
+	/// Single pass over JSON text without building a DOM. Missing keys keep the values already in result.
+	static bool ParseConfig(const char* json, Input* input, ParsedConfig& result);
 
 	void Load();
+	/// Request a save. The file is written on a worker thread after SAVE_COALESCE_MSEC.
 	void Save();
+	/// Write pending changes now and wait for in-flight writes. Call on shutdown.
+	void Flush();
 
-	void LoadActionMap();
+	/// Mark every action for serialization on the next save.
 	void SaveUserActionMap();
 
+	/// Typed access through ConfigKeys, resolved at compile time.
+	template <class T>
+	const T& Get(const Key<T>& key) const { return values_.*key.member_; }
+
+	template <class T>
+	void Set(const Key<T>& key, const typename Key<T>::ValueType& value)
+	{
+		T& slot = values_.*key.member_;
+		if (slot == value)
+			return;
+
+		slot = value;
+		dirtyParameters_ |= ParameterBit(key.parameter_);
+		uncommittedParameters_ |= ParameterBit(key.parameter_);
+	}
+
+	/// Access by name. Known parameters go to their typed slot, other names to the JSON root.
 	void SetValue(const String& name, Variant value);
 	Variant GetValue(const String& name) const;
 
-	bool GetActionKeyInput(GameInputActions action) const;
+	/// Action is held this frame. Resolved once per frame on E_INPUTEND.
+	bool GetActionKeyInput(GameInputActions action) const { return actionsDown_[static_cast<U32>(action)]; }
+	/// Action went down since the previous frame.
+	bool GetActionKeyPressed(GameInputActions action) const { return actionsPressed_[static_cast<U32>(action)]; }
+	/// Action went up since the previous frame.
+	bool GetActionKeyReleased(GameInputActions action) const { return actionsReleased_[static_cast<U32>(action)]; }
+
+	const ActionMask& GetActionsDown() const { return actionsDown_; }
+	const ActionMask& GetActionsPressed() const { return actionsPressed_; }
+	const ActionMask& GetActionsReleased() const { return actionsReleased_; }
+
+	/// Actions currently bound to the key.
+	ActionMask GetActionsBoundTo(InputDeviceType device, S32 key) const;
+
+	/// Pop the oldest action transition. Returns false when the queue is empty.
+	bool PollActionEvent(ActionEvent& actionEvent);
+	/// Transitions dropped because the queue was full, since start.
+	U32 GetDroppedActionEvents() const { return droppedActionEvents_; }
+	/// Current time in microseconds in the time base of queued action events.
+	long long GetInputTime() const { return inputTimer_.GetUSec(false); }
 
 	/**
 	 * unitNumber == 0 for primary key
 	 * unitNumber == 1 for secondary key
 	 */
-	String GetActionKeyName(GameInputActions action, U32 unitNumber) const;
-	void SetActionKey(GameInputActions action, InputDeviceType device, S32 key, U32 unitNumber);
+	ActionUnit GetActionUnit(GameInputActions action, U32 unitNumber) const;
+	const String& GetActionKeyName(GameInputActions action, U32 unitNumber) const;
+	/// Returns other actions that are also bound to the key.
+	ActionMask SetActionKey(GameInputActions action, InputDeviceType device, S32 key, U32 unitNumber);
 private:
 
+	void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+	/// Resolve the action snapshot from the key events Input dispatched this frame.
+	void HandleInputEnd(StringHash eventType, VariantMap& eventData);
+	void HandleKeyDown(StringHash eventType, VariantMap& eventData);
+	void HandleKeyUp(StringHash eventType, VariantMap& eventData);
+	void HandleMouseButtonDown(StringHash eventType, VariantMap& eventData);
+	void HandleMouseButtonUp(StringHash eventType, VariantMap& eventData);
+	void HandleInputFocus(StringHash eventType, VariantMap& eventData);
+	void HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData);
+	void HandleChangeLanguage(StringHash eventType, VariantMap& eventData);
+
+	String ResolveKeyName(Input* input, InputDeviceType device, S32 key) const;
+
+	void RebuildActionIndex();
+	/// Recount held actions from Input after bindings change or key state was reset.
+	void ResyncHeldActions();
+	void ResyncHeldAction(Input* input, U32 action, long long time);
+	void OnActionUnitInput(InputDeviceType device, S32 key, bool down);
+	void UpdateActionHeld(U32 action, bool held, long long time);
+	void PushActionEvent(U32 action, bool pressed, long long time);
+
+	/// Write parameters changed since the last call into the JSON root.
+	void SyncParametersToJson();
+	/// Patch the controls nodes of actions changed since the last call.
+	void SyncActionsToJson();
+
+	/// Serialize the JSON root and hand it to the save worker.
+	void DispatchSave();
+	/// Write serialized configs until none is pending. Runs on a worker thread, or inline without WorkQueue.
+	void WritePendingSaves();
+	/// Write to a temporary file and rename it over configFileName_.
+	bool WriteConfigFile(const String& content);
+
+	static void SaveWork(const WorkItem* item, unsigned threadIndex);
+
+	/**
+	 * Binary cache of the resolved config next to the JSON file. It is used at startup only
+	 * while the JSON size, modification time and checksum match the ones recorded in it.
+	 */
+	bool LoadCache(ParsedConfig& parsed);
+	bool WriteCacheFile(const void* json, U32 jsonSize, const PODVector<unsigned char>& payload);
+	static void WriteCachePayload(Serializer& dest, const ParsedConfig& parsed);
+	static void ReadCachePayload(Deserializer& source, ParsedConfig& parsed);
+
+	/**
+	 * Hot reload: configWatcher_ reports external edits of configFileName_, the file is parsed on
+	 * a worker and only keys edited in the file since it was last loaded or saved are applied on the main thread.
+	 */
+	void StartReload();
+	/// Read and parse configFileName_ into reloadResult_. Runs on a worker thread, or inline without WorkQueue.
+	void ParseReload();
+	void ApplyReload();
+
+	static void ReloadWork(const WorkItem* item, unsigned threadIndex);
+
 	JSONFile jsonFile_;
 	String configFileName_;
+	String cacheFileName_;
+	/// configFileName_ without the path, as configWatcher_ reports it
+	String watchedFileName_;
+
+	WeakPtr<FileSystem> fileSystem_;
+	WeakPtr<WorkQueue>  workQueue_;
 
-	ActionsMap userActionMap_;
+	/// coalescing of Save() requests on the main thread
+	bool  saveRequested_ = false;
+	Timer saveTimer_;
+
+	/// handoff to the save worker, guarded by saveMutex_
+	Mutex  saveMutex_;
+	String pendingSaveContent_;
+	PODVector<unsigned char> pendingSaveCache_;
+	U32    pendingSaveGeneration_ = 0;
+	U32    writtenSaveGeneration_ = 0;
+	bool   saveWorkQueued_        = false;
+	/// checksum of the content last handed to WriteConfigFile, lets reload skip our own saves
+	U32    savedContentChecksum_  = 0;
+
+	struct ReloadResult
+	{
+		PODVector<char> content_;
+		ParsedConfig    parsed_;
+		bool            loaded_  = false;
+		/// file holds what we saved last, there is nothing to apply
+		bool            ownSave_ = false;
+	};
+
+	SharedPtr<FileWatcher> configWatcher_;
+	/// config file changed while no reload was running or after it was read
+	bool reloadRequested_ = false;
+	SharedPtr<WorkItem> reloadItem_;
+	Input* reloadInput_ = nullptr;
+	/// written by the reload worker, read on the main thread after reloadItem_ completed
+	ReloadResult reloadResult_;
+	/// config file contents as last loaded, saved or reloaded, reloads apply only keys that differ from them
+	ConfigValues   fileValues_;
+	ActionBindings fileBindings_;
+
+	ConfigValues values_;
+	/// parameters not yet written into jsonFile_
+	ParameterMask dirtyParameters_ = 0;
+	/// actions whose bindings are not yet written into jsonFile_
+	ActionMask    dirtyActions_    = 0;
+	/// JSON root was modified directly through SetValue
+	bool          jsonChanged_     = false;
+	/// Load() ran, ApplyDisplaySettings() waits for the window
+	bool          displaySettingsPending_ = false;
+	void NotifyChanges(ParameterMask parameters, ActionMask actions);
+
+	static void ReleaseSnapshot(const Snapshot* snapshot);
+	/// Drop the publication reference of replaced snapshots when no reader is inside GetSnapshot().
+	void ReclaimSnapshots();
+
+	/// changes not yet published in snapshot_
+	ParameterMask uncommittedParameters_ = 0;
+	ActionMask    uncommittedActions_    = 0;
+	std::atomic<const Snapshot*> snapshot_{ nullptr };
+	/// readers between loading snapshot_ and taking their reference
+	mutable std::atomic<U32> snapshotReaders_{ 0 };
+	/// replaced snapshots still holding their publication reference, main thread only
+	PODVector<const Snapshot*> retiredSnapshots_;
+
+	/// JSON root holds only keys outside the schema, known keys are filled in on save
+	bool          jsonIncomplete_  = false;
+	/// JSON root has keys outside the schema, which the binary cache cannot hold
+	bool          jsonHasUnknownKeys_ = false;
+
+	ActionBindings userActionBindings_;
+	ActionIndex actionIndex_;
+
+	/// key names filled on first use, entries are only updated in place so references handed out stay valid
+	mutable std::unordered_map<ActionUnit, String, ActionUnitHash> keyLabels_;
+
+	/// number of held keys per action, updated from input events
+	U32 actionHeldCounts_[ACTIONS_COUNT] = {};
+	ActionMask actionsHeld_            = 0;
+	ActionMask actionsPressedPending_  = 0;
+	ActionMask actionsReleasedPending_ = 0;
+
+	/// ring buffer of action transitions, oldest is dropped on overflow
+	mutable HiresTimer inputTimer_;
+	ActionEvent actionEvents_[ACTION_EVENT_QUEUE_SIZE];
+	U32 actionEventsStart_ = 0;
+	U32 actionEventsCount_ = 0;
+	U32 droppedActionEvents_ = 0;
+	long long actionPressTimes_[ACTIONS_COUNT] = {};
+
+	/// per-frame action snapshot
+	ActionMask actionsDown_     = 0;
+	ActionMask actionsPressed_  = 0;
+	ActionMask actionsReleased_ = 0;
 };
+
+template <class T>
+using ConfigKey = Configuration::Key<T>;
+
+/// Handles for every CONFIG_PARAMETERS entry, e.g. config->Get(ConfigKeys::Width).
+namespace ConfigKeys
+{
+#define CONFIG_PARAMETER_KEY(id, name, type, defaultValue) \
+	static constexpr ConfigKey<type> id = { Configuration::ConfigParameter::id, &Configuration::ConfigValues::name##_ };
+	CONFIG_PARAMETERS(CONFIG_PARAMETER_KEY)
+#undef CONFIG_PARAMETER_KEY
+}
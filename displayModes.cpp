@@ -0,0 +1,259 @@
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/IO/Log.h>
+
+#include "config.h"
+#include "displayModes.h"
+#include "trace.h"
+
+S32 GraphicsDisplayModeBackend::GetMonitorCount()
+{
+	return graphics_ ? graphics_->GetMonitorCount() : 0;
+}
+
+PODVector<IntVector3> GraphicsDisplayModeBackend::GetModes(S32 monitor)
+{
+	return graphics_ ? graphics_->GetResolutions(monitor) : PODVector<IntVector3>();
+}
+
+DisplaySettings GraphicsDisplayModeBackend::GetSettings()
+{
+	DisplaySettings settings;
+	if (!graphics_)
+		return settings;
+
+	settings.width_ = graphics_->GetWidth();
+	settings.height_ = graphics_->GetHeight();
+	settings.fullscreen_ = graphics_->GetFullscreen();
+	settings.borderless_ = graphics_->GetBorderless();
+	settings.resizable_ = graphics_->GetResizable();
+	settings.highDPI_ = graphics_->GetHighDPI();
+	settings.vsync_ = graphics_->GetVSync();
+	settings.tripleBuffer_ = graphics_->GetTripleBuffer();
+	settings.multiSample_ = graphics_->GetMultiSample();
+	settings.monitor_ = graphics_->GetCurrentMonitor();
+	settings.refreshRate_ = graphics_->GetRefreshRate();
+	return settings;
+}
+
+bool GraphicsDisplayModeBackend::SetSettings(const DisplaySettings& settings)
+{
+	if (!graphics_)
+		return false;
+
+	return graphics_->SetMode(settings.width_, settings.height_, settings.fullscreen_, settings.borderless_,
+		settings.resizable_, settings.highDPI_, settings.vsync_, settings.tripleBuffer_, settings.multiSample_,
+		settings.monitor_, settings.refreshRate_);
+}
+
+static bool CompareRawModes(const IntVector3& lhs, const IntVector3& rhs)
+{
+	if (lhs.x_ != rhs.x_)
+		return lhs.x_ < rhs.x_;
+	if (lhs.y_ != rhs.y_)
+		return lhs.y_ < rhs.y_;
+	return lhs.z_ > rhs.z_;
+}
+
+DisplayModes::DisplayModes(Context* context, std::unique_ptr<IDisplayModeBackend> backend)
+	: Object(context)
+	, backend_(std::move(backend))
+{
+	workQueue_ = GetSubsystem<WorkQueue>();
+	if (workQueue_)
+		SubscribeToEvent(workQueue_, E_WORKITEMCOMPLETED, URHO3D_HANDLER(DisplayModes, HandleWorkItemCompleted));
+}
+
+DisplayModes::~DisplayModes()
+{
+	// the workers must not outlive the backend and the result buffer
+	UnsubscribeFromEvent(E_WORKITEMCOMPLETED);
+	if (!enumerateItems_.Empty() && workQueue_)
+		workQueue_->Complete(M_MAX_UNSIGNED);
+}
+
+void DisplayModes::Start()
+{
+	if (!enumerateItems_.Empty() || ready_)
+		return;
+
+	// the count is cheap, the modes of each monitor are what blocks. Sizing the buffer up front
+	// lets every batch write its own monitors without locking
+	U32 monitorCount = backend_ ? Max(backend_->GetMonitorCount(), 0) : 0;
+	enumeratedMonitors_.Clear();
+	enumeratedMonitors_.Resize(monitorCount);
+
+	if (!workQueue_ || !monitorCount)
+	{
+		Enumerate(0, monitorCount);
+		Publish();
+		return;
+	}
+
+	Configuration* config = GetSubsystem<Configuration>();
+	U32 batchSize = config ? config->GetTaskBatchSize(monitorCount) : monitorCount;
+	for (U32 first = 0; first < monitorCount; first += batchSize)
+	{
+		SharedPtr<WorkItem> item = workQueue_->GetFreeItem();
+		item->workFunction_ = EnumerateWork;
+		item->aux_ = this;
+		item->start_ = enumeratedMonitors_.Buffer() + first;
+		item->end_ = enumeratedMonitors_.Buffer() + Min(first + batchSize, monitorCount);
+		item->sendEvent_ = true;
+		item->priority_ = M_MAX_UNSIGNED;
+		enumerateItems_.Push(item);
+	}
+
+	// queued after the list is complete, a batch finishing early must not publish a partial result
+	for (const SharedPtr<WorkItem>& item : enumerateItems_)
+		workQueue_->AddWorkItem(item);
+}
+
+const DisplayModes::MonitorModes& DisplayModes::GetModes(S32 monitor) const
+{
+	static const MonitorModes noModes;
+
+	if (monitor < 0 || static_cast<U32>(monitor) >= monitors_.Size())
+		return noModes;
+
+	return monitors_[monitor];
+}
+
+DisplayModes::MonitorModes DisplayModes::BuildModes(const PODVector<IntVector3>& rawModes)
+{
+	PODVector<IntVector3> sorted = rawModes;
+	Sort(sorted.Begin(), sorted.End(), CompareRawModes);
+
+	MonitorModes modes;
+	for (const IntVector3& rawMode : sorted)
+	{
+		if (modes.Empty() || modes.Back().width_ != rawMode.x_ || modes.Back().height_ != rawMode.y_)
+		{
+			Mode mode;
+			mode.width_ = rawMode.x_;
+			mode.height_ = rawMode.y_;
+			modes.Push(mode);
+		}
+
+		PODVector<S32>& refreshRates = modes.Back().refreshRates_;
+		if (refreshRates.Empty() || refreshRates.Back() != rawMode.z_)
+			refreshRates.Push(rawMode.z_);
+	}
+
+	return modes;
+}
+
+bool DisplayModes::BeginSwitch(const DisplaySettings& settings)
+{
+	// a switch started during another one reverts to the settings that were confirmed last
+	if (!switchPending_)
+		previousSettings_ = backend_->GetSettings();
+
+	if (!SwitchTo(settings))
+	{
+		URHO3D_LOGERROR("Failed to switch display mode, restoring the previous one");
+		SwitchTo(previousSettings_);
+		switchPending_ = false;
+		UnsubscribeFromEvent(E_UPDATE);
+		return false;
+	}
+
+	switchPending_ = true;
+	revertTimer_.Reset();
+	SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(DisplayModes, HandleUpdate));
+	return true;
+}
+
+void DisplayModes::ConfirmSwitch()
+{
+	switchPending_ = false;
+	UnsubscribeFromEvent(E_UPDATE);
+}
+
+void DisplayModes::RevertSwitch()
+{
+	if (!switchPending_)
+		return;
+
+	switchPending_ = false;
+	UnsubscribeFromEvent(E_UPDATE);
+	SwitchTo(previousSettings_);
+}
+
+U32 DisplayModes::GetRevertRemainingMSec() const
+{
+	if (!switchPending_)
+		return 0;
+
+	U32 elapsed = revertTimer_.GetMSec(false);
+	return elapsed < REVERT_TIMEOUT_MSEC ? REVERT_TIMEOUT_MSEC - elapsed : 0;
+}
+
+void DisplayModes::HandleUpdate(StringHash eventType, VariantMap& eventData)
+{
+	if (GetRevertRemainingMSec())
+		return;
+
+	URHO3D_LOGINFO("Display mode was not confirmed, restoring the previous one");
+	RevertSwitch();
+	SendEvent(E_DISPLAYSWITCHREVERTED);
+}
+
+bool DisplayModes::SwitchTo(const DisplaySettings& settings)
+{
+	TRACE_ZONE(DisplaySwitch);
+
+	// SetMode returns after the device is recreated and GPU resources are restored
+	HiresTimer switchTimer;
+	bool switched = backend_->SetSettings(settings);
+	lastSwitchUSec_ = switchTimer.GetUSec(false);
+
+	URHO3D_LOGINFOF("Display switch to %dx%d@%d took %f ms", settings.width_, settings.height_,
+		settings.refreshRate_, lastSwitchUSec_ / 1000.0f);
+
+	return switched;
+}
+
+void DisplayModes::EnumerateWork(const WorkItem* item, unsigned threadIndex)
+{
+	DisplayModes* displayModes = static_cast<DisplayModes*>(item->aux_);
+	MonitorModes* monitors = displayModes->enumeratedMonitors_.Buffer();
+	U32 first = static_cast<U32>(static_cast<MonitorModes*>(item->start_) - monitors);
+	U32 end = static_cast<U32>(static_cast<MonitorModes*>(item->end_) - monitors);
+	displayModes->Enumerate(first, end);
+}
+
+void DisplayModes::Enumerate(U32 first, U32 end)
+{
+	for (U32 monitor = first; monitor < end; monitor++)
+		enumeratedMonitors_[monitor] = BuildModes(backend_->GetModes(monitor));
+}
+
+void DisplayModes::HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData)
+{
+	using namespace WorkItemCompleted;
+
+	void* completed = eventData[P_ITEM].GetVoidPtr();
+	for (U32 i = 0; i < enumerateItems_.Size(); i++)
+	{
+		if (enumerateItems_[i].Get() != completed)
+			continue;
+
+		enumerateItems_.Erase(i);
+		if (enumerateItems_.Empty())
+			Publish();
+		return;
+	}
+}
+
+void DisplayModes::Publish()
+{
+	monitors_.Clear();
+	monitors_.Swap(enumeratedMonitors_);
+	ready_ = true;
+
+	URHO3D_LOGINFOF("Enumerated display modes of %u monitors", monitors_.Size());
+
+	SendEvent(E_DISPLAYMODESREADY);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Math/Vector3.h>
+
+#include "utility/simpleTypes.h"
+
+#include <memory>
+
+using namespace Urho3D;
+
+/// Display modes were enumerated, DisplayModes::GetMonitors() is filled.
+URHO3D_EVENT(E_DISPLAYMODESREADY, DisplayModesReady)
+{
+}
+
+/// Unconfirmed display switch timed out and the previous settings were restored.
+URHO3D_EVENT(E_DISPLAYSWITCHREVERTED, DisplaySwitchReverted)
+{
+}
+
+namespace Urho3D
+{
+	class Graphics;
+}
+
+/// Everything Graphics::SetMode takes.
+struct DisplaySettings
+{
+	S32  width_        = 0;
+	S32  height_       = 0;
+	bool fullscreen_   = false;
+	bool borderless_   = false;
+	bool resizable_    = false;
+	bool highDPI_      = false;
+	bool vsync_        = false;
+	bool tripleBuffer_ = false;
+	S32  multiSample_  = 1;
+	S32  monitor_      = 0;
+	S32  refreshRate_  = 0;
+
+	bool operator==(const DisplaySettings& rhs) const
+	{
+		return width_ == rhs.width_ && height_ == rhs.height_ && fullscreen_ == rhs.fullscreen_ &&
+			borderless_ == rhs.borderless_ && resizable_ == rhs.resizable_ && highDPI_ == rhs.highDPI_ &&
+			vsync_ == rhs.vsync_ && tripleBuffer_ == rhs.tripleBuffer_ && multiSample_ == rhs.multiSample_ &&
+			monitor_ == rhs.monitor_ && refreshRate_ == rhs.refreshRate_;
+	}
+	bool operator!=(const DisplaySettings& rhs) const { return !(*this == rhs); }
+};
+
+/// Access to the display driver, a fake one can stand in for it.
+class IDisplayModeBackend
+{
+public:
+	virtual ~IDisplayModeBackend() = default;
+
+	virtual S32 GetMonitorCount() = 0;
+	/// Width, height and refresh rate per mode, in driver order and with duplicates. May run on several
+	/// worker threads at once, each for a different monitor.
+	virtual PODVector<IntVector3> GetModes(S32 monitor) = 0;
+
+	/// Main thread only.
+	virtual DisplaySettings GetSettings() = 0;
+	virtual bool SetSettings(const DisplaySettings& settings) = 0;
+};
+
+class GraphicsDisplayModeBackend : public IDisplayModeBackend
+{
+public:
+	explicit GraphicsDisplayModeBackend(Graphics* graphics) : graphics_(graphics) { }
+
+	virtual S32 GetMonitorCount();
+	virtual PODVector<IntVector3> GetModes(S32 monitor);
+	virtual DisplaySettings GetSettings();
+	virtual bool SetSettings(const DisplaySettings& settings);
+
+private:
+	WeakPtr<Graphics> graphics_;
+};
+
+/**
+ * Display modes of all monitors, enumerated once on worker threads in batches of
+ * Configuration::GetTaskBatchSize() monitors. Readers never wait for the driver, until
+ * E_DISPLAYMODESREADY the lists are empty.
+ *
+ * Display switches are transactional: BeginSwitch() keeps the previous settings, which are
+ * restored by RevertSwitch() or after REVERT_TIMEOUT_MSEC unless ConfirmSwitch() comes first.
+ */
+class DisplayModes : public Object
+{
+	URHO3D_OBJECT(DisplayModes, Object);
+
+public:
+	struct Mode
+	{
+		S32 width_;
+		S32 height_;
+		/// highest first
+		PODVector<S32> refreshRates_;
+	};
+
+	/// Modes of one monitor, unique by size and sorted by width, then height.
+	typedef Vector<Mode> MonitorModes;
+
+	DisplayModes(Context* context, std::unique_ptr<IDisplayModeBackend> backend);
+	virtual ~DisplayModes();
+
+	/// Queue the enumeration, or run it inline without WorkQueue.
+	void Start();
+
+	bool IsReady() const { return ready_; }
+	const Vector<MonitorModes>& GetMonitors() const { return monitors_; }
+	/// Empty when the monitor is unknown or enumeration has not finished.
+	const MonitorModes& GetModes(S32 monitor) const;
+
+	/// Merge raw modes that differ only in refresh rate.
+	static MonitorModes BuildModes(const PODVector<IntVector3>& rawModes);
+
+	static const U32 REVERT_TIMEOUT_MSEC = 15000;
+
+	DisplaySettings GetSettings() const { return backend_->GetSettings(); }
+	/// Switch display settings and start the revert countdown. On failure the previous settings are restored.
+	bool BeginSwitch(const DisplaySettings& settings);
+	void ConfirmSwitch();
+	void RevertSwitch();
+	bool IsSwitchPending() const { return switchPending_; }
+	U32 GetRevertRemainingMSec() const;
+	/// Duration of the last SetMode call, including the GPU resource reload it triggers.
+	long long GetLastSwitchUSec() const { return lastSwitchUSec_; }
+
+private:
+	void HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData);
+	void HandleUpdate(StringHash eventType, VariantMap& eventData);
+
+	bool SwitchTo(const DisplaySettings& settings);
+
+	/// Runs on a worker thread, writes enumeratedMonitors_ from first up to end.
+	void Enumerate(U32 first, U32 end);
+	void Publish();
+
+	static void EnumerateWork(const WorkItem* item, unsigned threadIndex);
+
+	std::unique_ptr<IDisplayModeBackend> backend_;
+	WeakPtr<WorkQueue> workQueue_;
+	/// one per batch, removed as they complete
+	Vector<SharedPtr<WorkItem> > enumerateItems_;
+
+	/// written by the workers, moved to monitors_ on the main thread after all enumerateItems_ completed
+	Vector<MonitorModes> enumeratedMonitors_;
+
+	Vector<MonitorModes> monitors_;
+	bool ready_ = false;
+
+	DisplaySettings previousSettings_;
+	bool switchPending_ = false;
+	mutable Timer revertTimer_;
+	long long lastSwitchUSec_ = 0;
+};
@@ -0,0 +1,22 @@
+#include <Urho3D/Graphics/Graphics.h>
+
+#include "displayModes.h"
+#include "gameSubsystems.h"
+#include "perfOverlayState.h"
+
+void RegisterGameSubsystems(Context* context)
+{
+	// enumeration may block on the display driver, so it starts in the background long before a menu needs it
+	Graphics* graphics = context->GetSubsystem<Graphics>();
+	if (graphics && !context->GetSubsystem<DisplayModes>())
+	{
+		DisplayModes* displayModes = new DisplayModes(context,
+			std::unique_ptr<IDisplayModeBackend>(new GraphicsDisplayModeBackend(graphics)));
+		context->RegisterSubsystem(displayModes);
+		displayModes->Start();
+	}
+
+	// the overlay follows its configuration key on top of any state
+	if (!context->GetSubsystem<PerfOverlayState>())
+		context->RegisterSubsystem(new PerfOverlayState(context));
+}
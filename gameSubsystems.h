@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Urho3D/Core/Context.h>
+
+using namespace Urho3D;
+
+/**
+ * Create the subsystems shared by the game states that do not exist yet: DisplayModes once Graphics
+ * is up, and the performance overlay. Startup may call it after Engine::Initialize() and Configuration::Load(),
+ * the menu states call it on construction, so the subsystems exist either way.
+ */
+void RegisterGameSubsystems(Context* context);
@@ -0,0 +1,77 @@
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Resource/Localization.h>
+#include <Urho3D/Resource/ResourceEvents.h>
+#include <Urho3D/UI/Text.h>
+
+#include "localizedTextIndex.h"
+
+LocalizedTextIndex::LocalizedTextIndex(Context* context)
+	: Object(context)
+{
+	SubscribeToEvent(E_CHANGELANGUAGE, URHO3D_HANDLER(LocalizedTextIndex, HandleChangeLanguage));
+}
+
+void LocalizedTextIndex::Add(UIElement* root, Text* skip)
+{
+	PODVector<UIElement*> elements;
+	root->GetChildren(elements, true);
+
+	for (UIElement* element : elements)
+	{
+		Text* text = dynamic_cast<Text*>(element);
+		if (!text || text == skip || !text->GetAutoLocalizable())
+			continue;
+
+		// with auto localization on, the text attribute holds the string id
+		Add(text, text->GetTextAttr());
+	}
+}
+
+void LocalizedTextIndex::Add(Text* text, const String& id)
+{
+	if (id.Empty())
+		return;
+
+	// the index updates the text from now on, not its own E_CHANGELANGUAGE handler
+	text->SetAutoLocalizable(false);
+	text->SetText(Get(id));
+
+	texts_[id].Push(WeakPtr<Text>(text));
+}
+
+void LocalizedTextIndex::Clear()
+{
+	texts_.Clear();
+}
+
+void LocalizedTextIndex::SetFallback(const String& id, const String& text)
+{
+	fallbacks_[id] = text;
+}
+
+String LocalizedTextIndex::Get(const String& id) const
+{
+	// Localization returns the id itself when it has no translation
+	String value = GetSubsystem<Localization>()->Get(id);
+	if (value == id)
+		fallbacks_.TryGetValue(id, value);
+
+	return value;
+}
+
+void LocalizedTextIndex::HandleChangeLanguage(StringHash eventType, VariantMap& eventData)
+{
+	URHO3D_PROFILE(LocalizedTextIndexUpdate);
+
+	for (auto& entry : texts_)
+	{
+		const String value = Get(entry.first_);
+
+		// setting a text re-measures it and marks only its parent layout dirty
+		for (WeakPtr<Text>& text : entry.second_)
+		{
+			if (text && text->GetText() != value)
+				text->SetText(value);
+		}
+	}
+}
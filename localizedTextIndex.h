@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Core/Object.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Text;
+	class UIElement;
+}
+
+/**
+ * Localized texts of a state grouped by string id. On language change every id is resolved
+ * once and only texts whose string differs are set, instead of each auto-localized Text
+ * handling the event on its own.
+ */
+class LocalizedTextIndex : public Object
+{
+	URHO3D_OBJECT(LocalizedTextIndex, Object);
+
+public:
+	explicit LocalizedTextIndex(Context* context);
+
+	/// Take over the auto-localized texts below root, except skip.
+	void Add(UIElement* root, Text* skip = nullptr);
+	void Add(Text* text, const String& id);
+	void Clear();
+
+	/// Text shown for id while the strings file has no translation of it.
+	void SetFallback(const String& id, const String& text);
+	/// String of id in the current language, or its fallback.
+	String Get(const String& id) const;
+
+private:
+	void HandleChangeLanguage(StringHash eventType, VariantMap& eventData);
+
+	HashMap<String, Vector<WeakPtr<Text> > > texts_;
+	HashMap<String, String> fallbacks_;
+};
@@ -10,67 +10,122 @@
 #include "utility/sharedData.h"
 
 #include "mainMenu/menuControlsPropertiesState.h"
+#include "gameSubsystems.h"
+#include "trace.h"
 
 using namespace Urho3D;
 
+const char* const MenuControlsPropertiesState::PRELOAD_MANIFEST[] =
+{
+	"UI/DefaultStyle.xml",
+	"UI/menuProperties/menuControlsProperties.xml",
+	"UI/parts/configControl.xml",
+};
+
 MenuControlsPropertiesState::MenuControlsPropertiesState(Urho3D::Context * context)
 	: IGameState(context)
 {
+	PreloadUIResources(GetSubsystem<ResourceCache>(), PRELOAD_MANIFEST);
+
+	// created here when startup did not
+	RegisterGameSubsystems(context_);
 }
 
 void MenuControlsPropertiesState::Create()
 {
+	TRACE_ZONE(MenuControlsCreate);
+
+	timeToInteractive_.Start();
+
 	ResourceCache* cache = GetSubsystem<ResourceCache>();
-	XMLFile* style = cache->GetResource<XMLFile>("UI/DefaultStyle.xml");
+	style_ = cache->GetResource<XMLFile>("UI/DefaultStyle.xml");
 	XMLFile* layout = cache->GetResource<XMLFile>("UI/menuProperties/menuControlsProperties.xml");
-	uiStateRoot_->LoadXML(layout->GetRoot(), style);
+	uiStateRoot_->LoadXML(layout->GetRoot(), style_);
 
 	window_ =           static_cast<Window*>(uiStateRoot_->GetChild("window_", true));
-	UIElement* actionsBar = uiStateRoot_->GetChild("actionsBar_", true);
+	actionsBar_ =       uiStateRoot_->GetChild("actionsBar_", true);
 
-	Configuration* config = GetSubsystem<Configuration>();
-	if (!config)
-		return;
+	localizedTexts_ = new LocalizedTextIndex(context_);
+	localizedTexts_->Add(uiStateRoot_);
 
-	for (Configuration::GameInputActions action = Configuration::GameInputActions::MoveForward;
-		action != Configuration::GameInputActions::Count; action = (Configuration::GameInputActions)((U32)action + 1))
-	{
-		UIElement* actionUIElement = actionsBar->CreateChild<UIElement>();
+	// only visible rows are instantiated, scrolling rebinds them to other actions
+	rowLayout_ = cache->GetResource<XMLFile>("UI/parts/configControl.xml");
+	U32 rowsCount = Min(VISIBLE_ROWS, Configuration::ACTIONS_COUNT);
+	rows_.Reserve(rowsCount);
+	for (U32 rowNumber = 0; rowNumber < rowsCount; rowNumber++)
+		rows_.Push(CreateRow(actionsBar_, rowNumber));
 
-		XMLFile* style = cache->GetResource<XMLFile>("UI/DefaultStyle.xml");
-		XMLFile* layout = cache->GetResource<XMLFile>("UI/parts/configControl.xml");
-		actionUIElement->LoadXML(layout->GetRoot(), style);
+	// the action name's id changes with every rebind, so it keeps localizing itself
+	for (ControlRow& row : rows_)
+		localizedTexts_->Add(row.root_, row.actionName_);
+
+	BindRows();
+
+	returnToMenu_ =     static_cast<Button*>(uiStateRoot_->GetChild("returnToMenu_", true));
+	applyChanges_ =     static_cast<Button*>(uiStateRoot_->GetChild("applyChanges_", true));
+}
 
-		Text* actionText = static_cast<Text*>(actionUIElement->GetChild("actionName_", true));
-		Button* primaryKeyButton = static_cast<Button*>(actionUIElement->GetChild("primaryKey_", true));
-		primaryKeyButton->SetVar("action", static_cast<U32>(action));
-		primaryKeyButton->SetVar("unitNumber", 0);
-		SubscribeToEvent(primaryKeyButton, E_PRESSED, URHO3D_HANDLER(MenuControlsPropertiesState, HandleButtonPressed));
+MenuControlsPropertiesState::ControlRow MenuControlsPropertiesState::CreateRow(UIElement* parent, U32 rowNumber)
+{
+	// UI/parts/configControl.xml has one key button per binding slot
+	static const char* const keyNames[] = { "primaryKey_", "secondaryKey_" };
+	static const char* const keyTextNames[] = { "primaryKeyName_", "secondaryKeyName_" };
+	static_assert(sizeof(keyNames) / sizeof(keyNames[0]) == Configuration::ACTION_UNITS_PER_ACTION &&
+		sizeof(keyTextNames) / sizeof(keyTextNames[0]) == Configuration::ACTION_UNITS_PER_ACTION,
+		"configControl.xml needs a key button for every binding slot");
+
+	ControlRow row;
+	row.root_ = parent->CreateChild<UIElement>();
+	row.root_->LoadXML(rowLayout_->GetRoot(), style_);
+
+	// names are resolved once per pooled row, rebinding uses the handles
+	row.actionName_ = static_cast<Text*>(row.root_->GetChild("actionName_", true));
+	for (U32 unitNumber = 0; unitNumber < Configuration::ACTION_UNITS_PER_ACTION; unitNumber++)
+	{
+		row.keys_[unitNumber] = static_cast<Button*>(row.root_->GetChild(keyNames[unitNumber], true));
+		row.keyNames_[unitNumber] = static_cast<Text*>(row.root_->GetChild(keyTextNames[unitNumber], true));
 
-		Text* primaryKeyText = static_cast<Text*>(actionUIElement->GetChild("primaryKeyName_", true));
+		row.keys_[unitNumber]->SetVar("unitNumber", unitNumber);
+		SubscribeToEvent(row.keys_[unitNumber], E_PRESSED, URHO3D_HANDLER(MenuControlsPropertiesState, HandleButtonPressed));
+	}
 
-		Button* secondaryKeyButton = static_cast<Button*>(actionUIElement->GetChild("secondaryKey_", true));
-		secondaryKeyButton->SetVar("action", static_cast<U32>(action));
-		secondaryKeyButton->SetVar("unitNumber", 1);
-		SubscribeToEvent(secondaryKeyButton, E_PRESSED, URHO3D_HANDLER(MenuControlsPropertiesState, HandleButtonPressed));
+	return row;
+}
 
-		Text* secondaryKeyText = static_cast<Text*>(actionUIElement->GetChild("secondaryKeyName_", true));
+void MenuControlsPropertiesState::BindRow(ControlRow& row, Configuration::GameInputActions action)
+{
+	Configuration* config = GetSubsystem<Configuration>();
+	if (!config)
+		return;
 
-		actionText->SetText(Configuration::StringFromEnumActions(action));
-		primaryKeyText->SetText(config->GetActionKeyName(action, 0));
-		secondaryKeyText->SetText(config->GetActionKeyName(action, 1));
+	if (row.action_ != action)
+	{
+		row.action_ = action;
+		row.actionName_->SetText(Configuration::StringFromEnumActions(action));
+		for (U32 unitNumber = 0; unitNumber < Configuration::ACTION_UNITS_PER_ACTION; unitNumber++)
+			row.keys_[unitNumber]->SetVar("action", static_cast<U32>(action));
 	}
 
-	returnToMenu_ =     static_cast<Button*>(uiStateRoot_->GetChild("returnToMenu_", true));
-	applyChanges_ =     static_cast<Button*>(uiStateRoot_->GetChild("applyChanges_", true));
+	for (U32 unitNumber = 0; unitNumber < Configuration::ACTION_UNITS_PER_ACTION; unitNumber++)
+		row.keyNames_[unitNumber]->SetText(config->GetActionKeyName(action, unitNumber));
+}
+
+void MenuControlsPropertiesState::BindRows()
+{
+	for (U32 rowNumber = 0; rowNumber < rows_.Size(); rowNumber++)
+		BindRow(rows_[rowNumber], static_cast<Configuration::GameInputActions>(firstVisibleAction_ + rowNumber));
 }
 
 void MenuControlsPropertiesState::Enter()
 {
+	TRACE_ZONE(MenuControlsEnter);
+
 	uiStateRoot_->SetVisible(true);
 	uiStateRoot_->UpdateLayout();
 
 	SubscribeToEvents();
+
+	timeToInteractive_.Report(GetTypeName().CString());
 }
 
 void MenuControlsPropertiesState::SubscribeToEvents()
@@ -79,6 +134,12 @@ void MenuControlsPropertiesState::SubscribeToEvents()
 	SubscribeToEvent(applyChanges_, E_PRESSED, URHO3D_HANDLER(MenuControlsPropertiesState, HandleApplyButtonClick));
 
 	SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(MenuControlsPropertiesState, HandleUpdate));
+	SubscribeToEvent(E_MOUSEWHEEL, URHO3D_HANDLER(MenuControlsPropertiesState, HandleMouseWheel));
+
+	// bindings may also change from a reloaded config file
+	Configuration* config = GetSubsystem<Configuration>();
+	if (config)
+		config->SubscribeToChanges(this, 0, Configuration::ALL_ACTIONS, URHO3D_HANDLER(MenuControlsPropertiesState, HandleConfigChanged));
 }
 
 void MenuControlsPropertiesState::HandleBackButtonClick(StringHash eventType, VariantMap & eventData)
@@ -89,6 +150,8 @@ void MenuControlsPropertiesState::HandleBackButtonClick(StringHash eventType, Va
 		GameStates::TSPACE :
 		GameStates::MENU_PROPERTIES;
 
+	// the state manager switches states while handling the event
+	TRACE_ZONE(MenuControlsStateChange);
 	SendEvent(G_STATE_CHANGE,
 		GameChangeStateEvent::P_STATE, targetState);
 }
@@ -139,6 +202,34 @@ void MenuControlsPropertiesState::HandleMouseKeyDown(StringHash eventType, Varia
 	SetNewKey(Configuration::InputDeviceType::Mouse, mouseKey);
 }
 
+void MenuControlsPropertiesState::HandleMouseWheel(StringHash eventType, VariantMap & eventData)
+{
+	// rows are retargeted on scroll, so keep them while a key is awaited
+	if (selectedButton_ || rows_.Size() >= Configuration::ACTIONS_COUNT)
+		return;
+
+	S32 wheel = eventData[MouseWheel::P_WHEEL].GetInt();
+	S32 firstAction = Clamp(static_cast<S32>(firstVisibleAction_) - wheel, 0, static_cast<S32>(Configuration::ACTIONS_COUNT - rows_.Size()));
+	if (static_cast<U32>(firstAction) == firstVisibleAction_)
+		return;
+
+	firstVisibleAction_ = firstAction;
+	BindRows();
+}
+
+void MenuControlsPropertiesState::HandleConfigChanged(StringHash eventType, VariantMap & eventData)
+{
+	const Configuration::ActionMask& actions = *static_cast<const Configuration::ActionMask*>(eventData[ConfigChanged::P_ACTIONS].GetVoidPtr());
+
+	for (ControlRow& row : rows_)
+	{
+		// the row awaiting a new key keeps showing "?"
+		bool awaitingKey = selectedButton_ && selectedButton_->GetVar("action").GetUInt() == static_cast<U32>(row.action_);
+		if (actions[static_cast<U32>(row.action_)] && !awaitingKey)
+			BindRow(row, row.action_);
+	}
+}
+
 void MenuControlsPropertiesState::SetNewKey(Configuration::InputDeviceType device, U32 key)
 {
 	if (selectedButton_)
@@ -162,8 +253,14 @@ void MenuControlsPropertiesState::SetNewKey(Configuration::InputDeviceType devic
 
 void MenuControlsPropertiesState::Exit()
 {
+	TRACE_ZONE(MenuControlsExit);
+
 	uiStateRoot_->SetVisible(false);
 
+	Configuration* config = GetSubsystem<Configuration>();
+	if (config)
+		config->UnsubscribeFromChanges(this);
+
 	UnsubscribeFromAllEvents();
 }
 
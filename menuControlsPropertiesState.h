@@ -4,11 +4,15 @@
 #include "utility/simpleTypes.h"
 
 #include "config.h"
+#include "localizedTextIndex.h"
+#include "uiPreload.h"
 
 namespace Urho3D
 {
 	class Button;
+	class Text;
 	class UIElement;
+	class XMLFile;
 }
 
 class MenuControlsPropertiesState : public IGameState
@@ -27,8 +31,39 @@ public:
 	virtual void Resume();
 
 private:
+	/// Rows shown at once, the rest of the actions is reached by scrolling.
+	static const U32 VISIBLE_ROWS = 12;
+
+	/// Pooled row of UI/parts/configControl.xml with direct handles to its parts.
+	struct ControlRow
+	{
+		WeakPtr<UIElement> root_;
+		WeakPtr<Text>      actionName_;
+		WeakPtr<Button>    keys_[Configuration::ACTION_UNITS_PER_ACTION];
+		WeakPtr<Text>      keyNames_[Configuration::ACTION_UNITS_PER_ACTION];
+		Configuration::GameInputActions action_ = Configuration::GameInputActions::Count;
+	};
+
+	ControlRow CreateRow(UIElement* parent, U32 rowNumber);
+	/// Show action in the row, also retargets its key buttons.
+	void BindRow(ControlRow& row, Configuration::GameInputActions action);
+	void BindRows();
+
+	/// UI resources loaded in the background from construction on
+	static const char* const PRELOAD_MANIFEST[];
+	TimeToInteractive     timeToInteractive_;
+
 	/// UI elements
 	WeakPtr<UIElement>    window_;
+	SharedPtr<LocalizedTextIndex> localizedTexts_;
+	WeakPtr<UIElement>    actionsBar_;
+
+	/// row layout and style are loaded once, pooled rows are instantiated from them
+	SharedPtr<XMLFile>    rowLayout_;
+	SharedPtr<XMLFile>    style_;
+
+	Vector<ControlRow>    rows_;
+	U32                   firstVisibleAction_ = 0;
 
 	WeakPtr<Button>       returnToMenu_;
 	WeakPtr<Button>       applyChanges_;
@@ -47,6 +82,8 @@ private:
 
 	void HandleKeyDown(StringHash eventType, VariantMap& eventData);
 	void HandleMouseKeyDown(StringHash eventType, VariantMap& eventData);
+	void HandleMouseWheel(StringHash eventType, VariantMap& eventData);
+	void HandleConfigChanged(StringHash eventType, VariantMap& eventData);
 
 	void SetNewKey(Configuration::InputDeviceType device, U32 key);
 };
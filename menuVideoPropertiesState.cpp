@@ -1,8 +1,11 @@
 #include <Urho3D/UI/Window.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
 #include <Urho3D/Graphics/Graphics.h>
 #include <Urho3D/UI/UIEvents.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Resource/Localization.h>
+#include <Urho3D/Resource/ResourceEvents.h>
 #include <Urho3D/UI/Text.h>
 #include <Urho3D/UI/DropDownList.h>
 #include <Urho3D/UI/ListView.h>
@@ -11,11 +14,60 @@
 #include "stateManager/gameStateEvents.h"
 #include "utility/sharedData.h"
 #include "config.h"
+#include "displayModes.h"
+#include "gameSubsystems.h"
 
 #include "mainMenu/menuVideoPropertiesState.h"
+#include "trace.h"
 
 using namespace Urho3D;
 
+const char* const MenuVideoPropertiesState::PRELOAD_MANIFEST[] =
+{
+	"UI/DefaultStyle.xml",
+	"UI/menuProperties/menuVideoProperties.xml",
+};
+
+/// English texts of the labels this menu adds, shown while the strings file has no translation for their ids.
+static const char* const FallbackStrings[][2] =
+{
+	{ "videoMonitor",            "Monitor" },
+	{ "videoRefreshRate",        "Refresh rate" },
+	{ "videoVSync",              "Vertical sync" },
+	{ "videoTripleBuffer",       "Triple buffering" },
+	{ "videoFpsLimit",           "Frame rate limit" },
+	{ "videoBackgroundFpsLimit", "Background frame rate limit" },
+	{ "videoPerfOverlay",        "Performance overlay" },
+	{ "videoWorkerThreads",      "Worker threads" },
+	{ "videoKeepMode",           "Keep" },
+	{ "videoRevertMode",         "Revert" },
+	{ "videoKeepModeCountdown",  "Keep this display mode? Reverting in {0} s" },
+	{ "videoMonitorItem",        "Monitor {0}" },
+	{ "videoRefreshRateItem",    "{0} Hz" },
+	{ "optionOff",               "Off" },
+	{ "optionOn",                "On" },
+	{ "fpsUnlimited",            "Unlimited" },
+	{ "threadsAuto",             "Auto" },
+};
+
+const U32 MenuVideoPropertiesState::FPS_LIMITS[] = { 0, 30, 60, 120, 144, 165, 240, 360 };
+const U32 MenuVideoPropertiesState::FPS_LIMITS_COUNT = sizeof(FPS_LIMITS) / sizeof(FPS_LIMITS[0]);
+
+S32 MenuVideoPropertiesState::FpsLimitIndex(U32 fps)
+{
+	// a cap edited into the config file is shown as the nearest higher preset, or the highest one
+	if (!fps)
+		return 0;
+
+	for (U32 i = 1; i < FPS_LIMITS_COUNT; i++)
+	{
+		if (FPS_LIMITS[i] >= fps)
+			return i;
+	}
+
+	return FPS_LIMITS_COUNT - 1;
+}
+
 String MenuVideoPropertiesState::FullscreenToString(FullscreenMode mode) const
 {
 	switch (mode)
@@ -35,19 +87,37 @@ MenuVideoPropertiesState::MenuVideoPropertiesState(Urho3D::Context * context) :
 	IGameState(context),
 	resolution_(0),
 	fullscreen_(FullscreenMode::Windowed),
-	languageIndex_(0)
+	languageIndex_(0),
+	monitor_(0),
+	refreshRate_(0),
+	vsync_(false),
+	tripleBuffer_(false),
+	maxFps_(0),
+	maxInactiveFps_(0),
+	perfOverlay_(false),
+	threads_(0)
 {
-	// TODO: take into account multiple monitors
-	Graphics* graphics = GetSubsystem<Graphics>();
-	PODVector<IntVector3> supportedResolutions = graphics->GetResolutions(0);
-	for (U32 i = 0; i < supportedResolutions.Size(); i++)
-	{
-		resolutions_.Push(Resolution(supportedResolutions[i].x_, supportedResolutions[i].y_, supportedResolutions[i].z_));
-	}
+	PreloadUIResources(GetSubsystem<ResourceCache>(), PRELOAD_MANIFEST);
+
+	// created here when startup did not, still missing without Graphics
+	RegisterGameSubsystems(context_);
+	displayModes_ = GetSubsystem<DisplayModes>();
+}
+
+/// Modes of monitor, empty without DisplayModes.
+static const DisplayModes::MonitorModes& GetMonitorModes(const DisplayModes* displayModes, S32 monitor)
+{
+	static const DisplayModes::MonitorModes noModes;
+
+	return displayModes ? displayModes->GetModes(monitor) : noModes;
 }
 
 void MenuVideoPropertiesState::Create()
 {
+	TRACE_ZONE(MenuVideoCreate);
+
+	timeToInteractive_.Start();
+
 	ResourceCache* cache = GetSubsystem<ResourceCache>();
 	XMLFile* style = cache->GetResource<XMLFile>("UI/DefaultStyle.xml");
 	XMLFile* layout = cache->GetResource<XMLFile>("UI/menuProperties/menuVideoProperties.xml");
@@ -59,62 +129,319 @@ void MenuVideoPropertiesState::Create()
 	languageList_ =     static_cast<DropDownList*>(uiStateRoot_->GetChild("languageList_", true));
 	returnToMenu_ =     static_cast<Button*>(uiStateRoot_->GetChild("returnToMenu_", true));
 	applyChanges_ =     static_cast<Button*>(uiStateRoot_->GetChild("applyChanges_", true));
+
+	localizedTexts_ = new LocalizedTextIndex(context_);
+	localizedTexts_->Add(uiStateRoot_);
+	for (const char* const* fallback : FallbackStrings)
+		localizedTexts_->SetFallback(fallback[0], fallback[1]);
+
+	// display and frame pacing options follow the language row
+	UIElement* languageRow = languageList_->GetParent();
+	UIElement* optionsParent = languageRow->GetParent();
+	U32 optionIndex = optionsParent->FindChild(languageRow) + 1;
+	monitorList_ =        CreateOptionList(optionsParent, optionIndex++, "videoMonitor");
+	refreshRateList_ =    CreateOptionList(optionsParent, optionIndex++, "videoRefreshRate");
+	vsyncList_ =          CreateOptionList(optionsParent, optionIndex++, "videoVSync");
+	tripleBufferList_ =   CreateOptionList(optionsParent, optionIndex++, "videoTripleBuffer");
+	maxFpsList_ =         CreateOptionList(optionsParent, optionIndex++, "videoFpsLimit");
+	maxInactiveFpsList_ = CreateOptionList(optionsParent, optionIndex++, "videoBackgroundFpsLimit");
+	perfOverlayList_ =    CreateOptionList(optionsParent, optionIndex++, "videoPerfOverlay");
+	threadsList_ =        CreateOptionList(optionsParent, optionIndex++, "videoWorkerThreads");
+
+	confirmBar_ = optionsParent->CreateChild<UIElement>(String::EMPTY, optionIndex++);
+	confirmBar_->SetLayout(LM_HORIZONTAL, 8);
+	confirmText_ = confirmBar_->CreateChild<Text>();
+	confirmText_->SetStyleAuto();
+	keepMode_ = CreateTextButton(confirmBar_, "videoKeepMode");
+	revertMode_ = CreateTextButton(confirmBar_, "videoRevertMode");
+	confirmBar_->SetVisible(false);
+
+	// list contents persist across visits, Enter only updates the selections
+	Vector<String> fullscreenModes;
+	for (U32 i = 0; i < static_cast<unsigned>(FullscreenMode::Count); i++)
+		fullscreenModes.Push(FullscreenToString(static_cast<FullscreenMode>(i)));
+	SyncListItems(fullScreenList_, fullscreenModes);
+
+	Vector<String> switchStates;
+	switchStates.Push("optionOff");
+	switchStates.Push("optionOn");
+	DropDownList* switchLists[] = { vsyncList_, tripleBufferList_, perfOverlayList_ };
+	for (DropDownList* list : switchLists)
+	{
+		SyncListItems(list, switchStates);
+		for (U32 i = 0; i < switchStates.Size(); i++)
+			LocalizeListItem(list, i, switchStates[i]);
+	}
+
+	Vector<String> fpsLimits;
+	for (U32 i = 0; i < FPS_LIMITS_COUNT; i++)
+		fpsLimits.Push(FPS_LIMITS[i] ? String(FPS_LIMITS[i]) : String("fpsUnlimited"));
+	SyncListItems(maxFpsList_, fpsLimits);
+	SyncListItems(maxInactiveFpsList_, fpsLimits);
+	LocalizeListItem(maxFpsList_, 0, "fpsUnlimited");
+	LocalizeListItem(maxInactiveFpsList_, 0, "fpsUnlimited");
+
+	// item index is the thread count, changes apply after a restart. Auto and the last item are the same count
+	U32 maxThreads = Configuration::GetMaxWorkerThreads();
+	Vector<String> threadCounts;
+	threadCounts.Push("threadsAuto");
+	for (U32 i = 1; i <= maxThreads; i++)
+		threadCounts.Push(String(i));
+	SyncListItems(threadsList_, threadCounts);
+	LocalizeListItem(threadsList_, 0, "threadsAuto");
+
+	monitor_ = GetSubsystem<Graphics>()->GetCurrentMonitor();
+	itemsLanguage_ = GetSubsystem<Localization>()->GetLanguageIndex();
+	RefreshMonitorItems();
+	RefreshResolutionItems();
+	RefreshRefreshRateItems();
+	RefreshLanguageItems();
 }
 
-void MenuVideoPropertiesState::Enter()
+DropDownList* MenuVideoPropertiesState::CreateOptionList(UIElement* parent, U32 index, const String& labelId)
 {
-	Graphics* graphics = GetSubsystem<Graphics>();
-	for (U32 i = 0; i < resolutions_.Size(); i++)
-	{
-		Text* resolutionItem = new Text(context_);
-		resolutionItem->SetText(resolutions_[i].ToString());
-		resolutionItem->SetStyleAuto();
+	UIElement* row = parent->CreateChild<UIElement>(String::EMPTY, index);
+	row->SetLayout(LM_HORIZONTAL, 8);
 
-		resolutionList_->AddItem(resolutionItem);
+	Text* labelText = row->CreateChild<Text>();
+	labelText->SetStyleAuto();
+	localizedTexts_->Add(labelText, labelId);
 
-		if (graphics->GetWidth() == resolutions_[i].width && graphics->GetHeight() == resolutions_[i].height)
+	DropDownList* list = row->CreateChild<DropDownList>();
+	list->SetStyleAuto();
+	list->SetResizePopup(true);
+
+	return list;
+}
+
+void MenuVideoPropertiesState::SyncListItems(DropDownList* list, const Vector<String>& labels)
+{
+	U32 itemsCount = list->GetNumItems();
+
+	for (U32 i = 0; i < labels.Size(); i++)
+	{
+		if (i < itemsCount)
 		{
-			resolution_ = i;
+			Text* item = static_cast<Text*>(list->GetItem(i));
+			if (item->GetText() != labels[i])
+				item->SetText(labels[i]);
+			continue;
 		}
-	}
 
-	resolutionList_->GetListView()->SetSelection(resolution_);
+		SharedPtr<Text> item;
+		if (textPool_.Empty())
+		{
+			item = new Text(context_);
+		}
+		else
+		{
+			item = textPool_.Back();
+			textPool_.Pop();
+		}
 
-	fullscreen_ = FullscreenMode::Windowed;
-	if (graphics->GetFullscreen())
+		item->SetText(labels[i]);
+		item->SetStyleAuto();
+		list->AddItem(item);
+	}
+
+	for (U32 i = itemsCount; i-- > labels.Size();)
 	{
-		fullscreen_ = graphics->GetBorderless() ? FullscreenMode::Borderless : fullscreen_ = FullscreenMode::Fullscreen;
+		textPool_.Push(SharedPtr<Text>(static_cast<Text*>(list->GetItem(i))));
+		list->RemoveItem(i);
 	}
+}
 
-	for (U32 i = 0; i < static_cast<unsigned>(FullscreenMode::Count); i++)
+Button* MenuVideoPropertiesState::CreateTextButton(UIElement* parent, const String& labelId)
+{
+	Button* button = parent->CreateChild<Button>();
+	button->SetStyleAuto();
+	button->SetLayout(LM_HORIZONTAL, 0);
+
+	Text* labelText = button->CreateChild<Text>();
+	labelText->SetStyleAuto();
+	localizedTexts_->Add(labelText, labelId);
+
+	return button;
+}
+
+void MenuVideoPropertiesState::LocalizeListItem(DropDownList* list, U32 index, const String& id)
+{
+	localizedTexts_->Add(static_cast<Text*>(list->GetItem(index)), id);
+}
+
+void MenuVideoPropertiesState::RefreshMonitorItems()
+{
+	const String format = localizedTexts_->Get("videoMonitorItem");
+	Vector<String> labels;
+	U32 monitorsCount = displayModes_ ? displayModes_->GetMonitors().Size() : 0;
+	for (U32 i = 0; i < monitorsCount; i++)
+		labels.Push(format.Replaced("{0}", String(i + 1)));
+
+	SyncListItems(monitorList_, labels);
+	monitorList_->GetListView()->SetSelection(monitor_);
+}
+
+void MenuVideoPropertiesState::RefreshResolutionItems()
+{
+	// sizes of the selected monitor with the highest refresh rate of each, the others are in refreshRateList_
+	const DisplayModes::MonitorModes& modes = GetMonitorModes(displayModes_, monitor_);
+
+	resolutions_.Clear();
+	for (const DisplayModes::Mode& mode : modes)
+		resolutions_.Push(Resolution(mode.width_, mode.height_, mode.refreshRates_.Front()));
+
+	Vector<String> labels;
+	labels.Reserve(resolutions_.Size());
+	for (U32 i = 0; i < resolutions_.Size(); i++)
+		labels.Push(resolutions_[i].ToString());
+
+	SyncListItems(resolutionList_, labels);
+}
+
+const PODVector<S32>& MenuVideoPropertiesState::GetRefreshRates() const
+{
+	static const PODVector<S32> noRefreshRates;
+
+	const DisplayModes::MonitorModes& modes = GetMonitorModes(displayModes_, monitor_);
+	if (resolution_ < 0 || resolution_ >= static_cast<S32>(modes.Size()))
+		return noRefreshRates;
+
+	return modes[resolution_].refreshRates_;
+}
+
+void MenuVideoPropertiesState::RefreshRefreshRateItems()
+{
+	const PODVector<S32>& refreshRates = GetRefreshRates();
+
+	// labels change only with the mode, re-entering the menu just updates the selection
+	if (monitor_ != refreshRatesMonitor_ || resolution_ != refreshRatesResolution_)
 	{
-		FullscreenMode mode = static_cast<FullscreenMode>(i);
-		Text* fullscreenItem = new Text(context_);
-		fullscreenItem->SetText(FullscreenToString(mode));
-		fullscreenItem->SetStyleAuto();
+		refreshRatesMonitor_ = monitor_;
+		refreshRatesResolution_ = resolution_;
 
-		fullScreenList_->AddItem(fullscreenItem);
+		const String format = localizedTexts_->Get("videoRefreshRateItem");
+		Vector<String> labels;
+		labels.Reserve(refreshRates.Size());
+		for (U32 i = 0; i < refreshRates.Size(); i++)
+			labels.Push(format.Replaced("{0}", String(refreshRates[i])));
+
+		SyncListItems(refreshRateList_, labels);
 	}
 
-	fullScreenList_->GetListView()->SetSelection(static_cast<U32>(fullscreen_));
+	// keep the current rate when the new mode offers it, otherwise take the highest
+	S32 currentRate = GetSubsystem<Graphics>()->GetRefreshRate();
+	refreshRate_ = 0;
+	for (U32 i = 0; i < refreshRates.Size(); i++)
+	{
+		if (refreshRates[i] == currentRate)
+			refreshRate_ = i;
+	}
+
+	refreshRateList_->GetListView()->SetSelection(refreshRate_);
+}
 
+void MenuVideoPropertiesState::RelocalizeItems()
+{
+	itemsLanguage_ = GetSubsystem<Localization>()->GetLanguageIndex();
+
+	RefreshMonitorItems();
+	refreshRatesMonitor_ = -1;
+	RefreshRefreshRateItems();
+
+	// the countdown is rewritten on the next update
+	confirmSecondsShown_ = 0;
+}
+
+void MenuVideoPropertiesState::RefreshLanguageItems()
+{
 	Localization* l10n = GetSubsystem<Localization>();
-	for (S32 i = 0; i < l10n->GetNumLanguages(); i++)
+	if (l10n->GetNumLanguages() == languagesCount_)
+		return;
+
+	languagesCount_ = l10n->GetNumLanguages();
+
+	Vector<String> labels;
+	labels.Reserve(languagesCount_);
+	for (S32 i = 0; i < languagesCount_; i++)
+		labels.Push(l10n->GetLanguage(i));
+
+	SyncListItems(languageList_, labels);
+}
+
+void MenuVideoPropertiesState::Enter()
+{
+	TRACE_ZONE(MenuVideoEnter);
+
+	Graphics* graphics = GetSubsystem<Graphics>();
+	if (resolutions_.Empty() || monitor_ != graphics->GetCurrentMonitor())
 	{
-		Text* languageItem = new Text(context_);
-		languageItem->SetText(l10n->GetLanguage(i));
-		languageItem->SetStyleAuto();
+		monitor_ = graphics->GetCurrentMonitor();
+		RefreshMonitorItems();
+		RefreshResolutionItems();
+	}
+
+	SelectCurrentResolution();
+	if (itemsLanguage_ != GetSubsystem<Localization>()->GetLanguageIndex())
+		RelocalizeItems();
+	else
+		RefreshRefreshRateItems();
+
+	vsync_ = graphics->GetVSync();
+	vsyncList_->GetListView()->SetSelection(vsync_ ? 1 : 0);
+	tripleBuffer_ = graphics->GetTripleBuffer();
+	tripleBufferList_->GetListView()->SetSelection(tripleBuffer_ ? 1 : 0);
 
-		languageList_->AddItem(languageItem);
+	Configuration* config = GetSubsystem<Configuration>();
+	maxFps_ = FpsLimitIndex(config->Get(ConfigKeys::MaxFps));
+	maxFpsList_->GetListView()->SetSelection(maxFps_);
+	maxInactiveFps_ = FpsLimitIndex(config->Get(ConfigKeys::MaxInactiveFps));
+	maxInactiveFpsList_->GetListView()->SetSelection(maxInactiveFps_);
+	maxFpsPicked_ = false;
+	maxInactiveFpsPicked_ = false;
+	perfOverlay_ = config->Get(ConfigKeys::PerfOverlay);
+	perfOverlayList_->GetListView()->SetSelection(perfOverlay_ ? 1 : 0);
+	threads_ = Min(config->Get(ConfigKeys::Threads), threadsList_->GetNumItems() - 1);
+	threadsList_->GetListView()->SetSelection(threads_);
+	threadsPicked_ = false;
+
+	fullscreen_ = FullscreenMode::Windowed;
+	if (graphics->GetFullscreen())
+	{
+		fullscreen_ = graphics->GetBorderless() ? FullscreenMode::Borderless : FullscreenMode::Fullscreen;
 	}
 
+	fullScreenList_->GetListView()->SetSelection(static_cast<U32>(fullscreen_));
+
+	RefreshLanguageItems();
+
+	Localization* l10n = GetSubsystem<Localization>();
 	languageIndex_ = l10n->GetLanguageIndex();
 	languageList_->GetListView()->SetSelection(languageIndex_);
 
+	ShowConfirmation(false);
+
 	uiStateRoot_->SetVisible(true);
 	uiStateRoot_->UpdateLayout();
 
 	SubscribeToEvents();
+
+	timeToInteractive_.Report(GetTypeName().CString());
+}
+
+void MenuVideoPropertiesState::SelectCurrentResolution()
+{
+	// a size the monitor does not offer selects its largest mode, -1 while there are no modes
+	Graphics* graphics = GetSubsystem<Graphics>();
+	resolution_ = static_cast<S32>(resolutions_.Size()) - 1;
+	for (U32 i = 0; i < resolutions_.Size(); i++)
+	{
+		if (graphics->GetWidth() == resolutions_[i].width && graphics->GetHeight() == resolutions_[i].height)
+		{
+			resolution_ = i;
+		}
+	}
+
+	resolutionList_->GetListView()->SetSelection(resolution_);
 }
 
 void MenuVideoPropertiesState::SubscribeToEvents()
@@ -122,8 +449,35 @@ void MenuVideoPropertiesState::SubscribeToEvents()
 	SubscribeToEvent(resolutionList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectResolution));
 	SubscribeToEvent(fullScreenList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectFullscreen));
 	SubscribeToEvent(languageList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectLanguage));
+	SubscribeToEvent(monitorList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectMonitor));
+	SubscribeToEvent(refreshRateList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectRefreshRate));
+	SubscribeToEvent(vsyncList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectVSync));
+	SubscribeToEvent(tripleBufferList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectTripleBuffer));
+	SubscribeToEvent(maxFpsList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectMaxFps));
+	SubscribeToEvent(maxInactiveFpsList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectMaxInactiveFps));
+	SubscribeToEvent(perfOverlayList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectPerfOverlay));
+	SubscribeToEvent(threadsList_, E_ITEMSELECTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleSelectThreads));
 	SubscribeToEvent(returnToMenu_, E_PRESSED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleBackButtonClick));
 	SubscribeToEvent(applyChanges_, E_PRESSED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleApplyButtonClick));
+	SubscribeToEvent(E_DISPLAYMODESREADY, URHO3D_HANDLER(MenuVideoPropertiesState, HandleDisplayModesReady));
+	SubscribeToEvent(keepMode_, E_PRESSED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleKeepModeClick));
+	SubscribeToEvent(revertMode_, E_PRESSED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleRevertModeClick));
+	SubscribeToEvent(E_DISPLAYSWITCHREVERTED, URHO3D_HANDLER(MenuVideoPropertiesState, HandleDisplaySwitchReverted));
+	SubscribeToEvent(E_CHANGELANGUAGE, URHO3D_HANDLER(MenuVideoPropertiesState, HandleChangeLanguage));
+}
+
+void MenuVideoPropertiesState::HandleChangeLanguage(StringHash eventType, VariantMap & eventData)
+{
+	RelocalizeItems();
+}
+
+void MenuVideoPropertiesState::HandleDisplayModesReady(StringHash eventType, VariantMap & eventData)
+{
+	refreshRatesMonitor_ = -1;
+	RefreshMonitorItems();
+	RefreshResolutionItems();
+	SelectCurrentResolution();
+	RefreshRefreshRateItems();
 }
 
 void MenuVideoPropertiesState::HandleSelectFullscreen(StringHash eventType, VariantMap & eventData)
@@ -134,6 +488,7 @@ void MenuVideoPropertiesState::HandleSelectFullscreen(StringHash eventType, Vari
 void MenuVideoPropertiesState::HandleSelectResolution(StringHash eventType, VariantMap & eventData)
 {
 	resolution_ = eventData[ItemSelected::P_SELECTION].GetInt();
+	RefreshRefreshRateItems();
 }
 
 void MenuVideoPropertiesState::HandleSelectLanguage(StringHash eventType, VariantMap & eventData)
@@ -141,6 +496,52 @@ void MenuVideoPropertiesState::HandleSelectLanguage(StringHash eventType, Varian
 	languageIndex_ = eventData[ItemSelected::P_SELECTION].GetInt();
 }
 
+void MenuVideoPropertiesState::HandleSelectMonitor(StringHash eventType, VariantMap & eventData)
+{
+	monitor_ = eventData[ItemSelected::P_SELECTION].GetInt();
+	RefreshResolutionItems();
+	SelectCurrentResolution();
+	RefreshRefreshRateItems();
+}
+
+void MenuVideoPropertiesState::HandleSelectRefreshRate(StringHash eventType, VariantMap & eventData)
+{
+	refreshRate_ = eventData[ItemSelected::P_SELECTION].GetInt();
+}
+
+void MenuVideoPropertiesState::HandleSelectVSync(StringHash eventType, VariantMap & eventData)
+{
+	vsync_ = eventData[ItemSelected::P_SELECTION].GetInt() != 0;
+}
+
+void MenuVideoPropertiesState::HandleSelectTripleBuffer(StringHash eventType, VariantMap & eventData)
+{
+	tripleBuffer_ = eventData[ItemSelected::P_SELECTION].GetInt() != 0;
+}
+
+void MenuVideoPropertiesState::HandleSelectMaxFps(StringHash eventType, VariantMap & eventData)
+{
+	maxFps_ = eventData[ItemSelected::P_SELECTION].GetInt();
+	maxFpsPicked_ = true;
+}
+
+void MenuVideoPropertiesState::HandleSelectMaxInactiveFps(StringHash eventType, VariantMap & eventData)
+{
+	maxInactiveFps_ = eventData[ItemSelected::P_SELECTION].GetInt();
+	maxInactiveFpsPicked_ = true;
+}
+
+void MenuVideoPropertiesState::HandleSelectPerfOverlay(StringHash eventType, VariantMap & eventData)
+{
+	perfOverlay_ = eventData[ItemSelected::P_SELECTION].GetInt() != 0;
+}
+
+void MenuVideoPropertiesState::HandleSelectThreads(StringHash eventType, VariantMap & eventData)
+{
+	threads_ = eventData[ItemSelected::P_SELECTION].GetUInt();
+	threadsPicked_ = true;
+}
+
 void MenuVideoPropertiesState::HandleBackButtonClick(StringHash eventType, VariantMap & eventData)
 {
 	bool isFromGame = GetSubsystem<SharedData>()->inGame_;
@@ -149,41 +550,147 @@ void MenuVideoPropertiesState::HandleBackButtonClick(StringHash eventType, Varia
 		GameStates::TSPACE :
 		GameStates::MENU_PROPERTIES;
 
+	// the state manager switches states while handling the event
+	TRACE_ZONE(MenuVideoStateChange);
 	SendEvent(G_STATE_CHANGE,
 		GameChangeStateEvent::P_STATE, targetState);
 }
 
 void MenuVideoPropertiesState::HandleApplyButtonClick(StringHash eventType, VariantMap & eventData)
 {
-	Graphics* graphics = GetSubsystem<Graphics>();
 	Configuration* config = GetSubsystem<Configuration>();
-
-	Resolution res = resolutions_[resolution_];
-	bool fullscreen = (fullscreen_ != FullscreenMode::Windowed);
-	bool borderless = (fullscreen_ == FullscreenMode::Borderless);
-
-	graphics->SetMode(res.width, res.height, fullscreen, borderless, false, false, false, false, 
-		0, 0, res.refreshRate);
-
-	config->SetValue("width", graphics->GetWidth());
-	config->SetValue("height", graphics->GetHeight());
-	config->SetValue("fullscreen", graphics->GetFullscreen());
-	config->SetValue("borderless", graphics->GetBorderless());
+	DisplayModes* displayModes = displayModes_;
+
+	if (displayModes && displayModes->IsSwitchPending())
+		return;
+
+	// Configuration pushes the caps to Engine when it commits them. A cap between presets is shown
+	// as the next preset, so it is only replaced when the user picks an item, even the one shown
+	if (maxFpsPicked_)
+		config->Set(ConfigKeys::MaxFps, FPS_LIMITS[maxFps_]);
+	if (maxInactiveFpsPicked_)
+		config->Set(ConfigKeys::MaxInactiveFps, FPS_LIMITS[maxInactiveFps_]);
+	config->Set(ConfigKeys::PerfOverlay, perfOverlay_);
+	// an override above the core count is shown as the last item and kept until the user picks one
+	if (threadsPicked_)
+		config->Set(ConfigKeys::Threads, threads_);
 
 	Localization* l10n = GetSubsystem<Localization>();
 	if (languageIndex_ != l10n->GetLanguageIndex())
 	{
 		l10n->SetLanguage(languageIndex_);
-		config->SetValue("lang", l10n->GetLanguage());
+		config->Set(ConfigKeys::Lang, l10n->GetLanguage());
+	}
+
+	// resolutions_ stays empty without DisplayModes
+	if (resolution_ >= 0 && resolution_ < static_cast<S32>(resolutions_.Size()))
+	{
+		Resolution res = resolutions_[resolution_];
+		const PODVector<S32>& refreshRates = GetRefreshRates();
+
+		DisplaySettings settings = displayModes->GetSettings();
+		settings.width_ = res.width;
+		settings.height_ = res.height;
+		settings.fullscreen_ = (fullscreen_ != FullscreenMode::Windowed);
+		settings.borderless_ = (fullscreen_ == FullscreenMode::Borderless);
+		settings.vsync_ = vsync_;
+		settings.tripleBuffer_ = tripleBuffer_;
+		settings.monitor_ = monitor_;
+		settings.refreshRate_ = refreshRate_ < static_cast<S32>(refreshRates.Size()) ? refreshRates[refreshRate_] : res.refreshRate;
+
+		// the other settings are saved once the new mode is kept or reverted
+		if (settings != displayModes->GetSettings() && displayModes->BeginSwitch(settings))
+		{
+			ShowConfirmation(true);
+			return;
+		}
 	}
 
 	config->Save();
+}
+
+void MenuVideoPropertiesState::HandleKeepModeClick(StringHash eventType, VariantMap & eventData)
+{
+	if (displayModes_)
+		displayModes_->ConfirmSwitch();
+	StoreDisplaySettings();
+	ShowConfirmation(false);
+}
+
+void MenuVideoPropertiesState::HandleRevertModeClick(StringHash eventType, VariantMap & eventData)
+{
+	if (displayModes_)
+		displayModes_->RevertSwitch();
+	HandleDisplaySwitchReverted(eventType, eventData);
+}
+
+void MenuVideoPropertiesState::HandleDisplaySwitchReverted(StringHash eventType, VariantMap & eventData)
+{
+	ShowConfirmation(false);
+
+	// selections follow the restored mode
+	SelectCurrentResolution();
+	RefreshRefreshRateItems();
+
+	GetSubsystem<Configuration>()->Save();
+}
+
+void MenuVideoPropertiesState::HandleUpdate(StringHash eventType, VariantMap & eventData)
+{
+	U32 seconds = displayModes_ ? (displayModes_->GetRevertRemainingMSec() + 999) / 1000 : 0;
+	if (seconds == confirmSecondsShown_)
+		return;
+
+	confirmSecondsShown_ = seconds;
+	confirmText_->SetText(localizedTexts_->Get("videoKeepModeCountdown").Replaced("{0}", String(seconds)));
+}
+
+void MenuVideoPropertiesState::ShowConfirmation(bool show)
+{
+	confirmBar_->SetVisible(show);
+	applyChanges_->SetEnabled(!show);
+
+	if (show)
+	{
+		confirmSecondsShown_ = 0;
+		SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(MenuVideoPropertiesState, HandleUpdate));
+	}
+	else
+	{
+		UnsubscribeFromEvent(E_UPDATE);
+	}
 
 	uiStateRoot_->UpdateLayout();
 }
 
+void MenuVideoPropertiesState::StoreDisplaySettings()
+{
+	Graphics* graphics = GetSubsystem<Graphics>();
+	Configuration* config = GetSubsystem<Configuration>();
+
+	config->Set(ConfigKeys::Width, graphics->GetWidth());
+	config->Set(ConfigKeys::Height, graphics->GetHeight());
+	config->Set(ConfigKeys::Fullscreen, graphics->GetFullscreen());
+	config->Set(ConfigKeys::Borderless, graphics->GetBorderless());
+	config->Set(ConfigKeys::VSync, graphics->GetVSync());
+	config->Set(ConfigKeys::TripleBuffer, graphics->GetTripleBuffer());
+	config->Set(ConfigKeys::Monitor, graphics->GetCurrentMonitor());
+	config->Set(ConfigKeys::RefreshRate, graphics->GetRefreshRate());
+
+	config->Save();
+}
+
 void MenuVideoPropertiesState::Exit()
 {
+	TRACE_ZONE(MenuVideoExit);
+
+	// leaving the menu does not keep an unconfirmed mode
+	if (displayModes_ && displayModes_->IsSwitchPending())
+	{
+		displayModes_->RevertSwitch();
+		GetSubsystem<Configuration>()->Save();
+	}
+
 	uiStateRoot_->SetVisible(false);
 
 	UnsubscribeFromAllEvents();
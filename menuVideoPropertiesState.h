@@ -3,10 +3,16 @@
 #include "stateManager/gameStates.h"
 #include "utility/simpleTypes.h"
 
+#include "localizedTextIndex.h"
+#include "uiPreload.h"
+
+class DisplayModes;
+
 namespace Urho3D
 {
 	class DropDownList;
 	class Button;
+	class Text;
 	class UIElement;
 }
 
@@ -29,6 +35,27 @@ private:
 	// options list
 	S32 resolution_;
 	S32 languageIndex_;
+	S32 monitor_;
+	/// index into GetRefreshRates()
+	S32 refreshRate_;
+	bool vsync_;
+	bool tripleBuffer_;
+	/// indices into FPS_LIMITS
+	S32 maxFps_;
+	S32 maxInactiveFps_;
+	/// an item was picked since Enter, the stored cap may lie between presets
+	bool maxFpsPicked_ = false;
+	bool maxInactiveFpsPicked_ = false;
+	bool perfOverlay_;
+	/// 0 is automatic
+	U32 threads_;
+	bool threadsPicked_ = false;
+
+	/// frame rate caps offered in the menu, 0 is uncapped
+	static const U32 FPS_LIMITS[];
+	static const U32 FPS_LIMITS_COUNT;
+
+	static S32 FpsLimitIndex(U32 fps);
 	enum class FullscreenMode
 	{
 		Windowed = 0,
@@ -57,13 +84,68 @@ private:
 	FullscreenMode fullscreen_;
 	Vector<Resolution> resolutions_;
 
+	/// Make list show labels, changing only differing items. Removed items go to textPool_.
+	void SyncListItems(DropDownList* list, const Vector<String>& labels);
+	/// Take resolutions_ from DisplayModes, empty until the modes are enumerated.
+	void RefreshResolutionItems();
+	void SelectCurrentResolution();
+	void RefreshMonitorItems();
+	void RefreshRefreshRateItems();
+	/// Rebuild the labels formatted from localized strings, the others follow LocalizedTextIndex.
+	void RelocalizeItems();
+	/// Refresh rates of the selected monitor and resolution, highest first.
+	const PODVector<S32>& GetRefreshRates() const;
+
+	/// Labeled list placed in parent at index, for options the layout file does not have. Labels are localization ids.
+	DropDownList* CreateOptionList(UIElement* parent, U32 index, const String& labelId);
+	Button* CreateTextButton(UIElement* parent, const String& labelId);
+	/// Keep a fixed list item in the current language.
+	void LocalizeListItem(DropDownList* list, U32 index, const String& id);
+
+	/// Display switch awaiting confirmation, the settings are persisted only once it is kept.
+	void ShowConfirmation(bool show);
+	void StoreDisplaySettings();
+
+	U32 confirmSecondsShown_ = 0;
+	void RefreshLanguageItems();
+
+	/// Text items removed from the lists, reused before new ones are created
+	Vector<SharedPtr<Text>> textPool_;
+	/// languages shown in languageList_, they are only ever added to Localization
+	S32 languagesCount_ = -1;
+	/// mode whose rates refreshRateList_ shows, -1 until built
+	S32 refreshRatesMonitor_ = -1;
+	S32 refreshRatesResolution_ = -1;
+	/// language of the formatted labels
+	S32 itemsLanguage_ = -1;
+
+	/// UI resources loaded in the background from construction on
+	static const char* const PRELOAD_MANIFEST[];
+	TimeToInteractive     timeToInteractive_;
+
+	/// null without Graphics
+	WeakPtr<DisplayModes> displayModes_;
+
 	/// UI elements
 	WeakPtr<UIElement>    window_;
+	SharedPtr<LocalizedTextIndex> localizedTexts_;
 	WeakPtr<DropDownList> resolutionList_;
 	WeakPtr<DropDownList> fullScreenList_;
 	WeakPtr<DropDownList> languageList_;
+	WeakPtr<DropDownList> monitorList_;
+	WeakPtr<DropDownList> refreshRateList_;
+	WeakPtr<DropDownList> vsyncList_;
+	WeakPtr<DropDownList> tripleBufferList_;
+	WeakPtr<DropDownList> maxFpsList_;
+	WeakPtr<DropDownList> maxInactiveFpsList_;
+	WeakPtr<DropDownList> perfOverlayList_;
+	WeakPtr<DropDownList> threadsList_;
 	WeakPtr<Button>       returnToMenu_;
 	WeakPtr<Button>       applyChanges_;
+	WeakPtr<UIElement>    confirmBar_;
+	WeakPtr<Text>         confirmText_;
+	WeakPtr<Button>       keepMode_;
+	WeakPtr<Button>       revertMode_;
 
 	// event related functions
 	void SubscribeToEvents();
@@ -71,7 +153,21 @@ private:
 	void HandleSelectFullscreen(StringHash eventType, VariantMap& eventData);
 	void HandleSelectResolution(StringHash eventType, VariantMap& eventData);
 	void HandleSelectLanguage(StringHash eventType, VariantMap& eventData);
+	void HandleSelectMonitor(StringHash eventType, VariantMap& eventData);
+	void HandleSelectRefreshRate(StringHash eventType, VariantMap& eventData);
+	void HandleSelectVSync(StringHash eventType, VariantMap& eventData);
+	void HandleSelectTripleBuffer(StringHash eventType, VariantMap& eventData);
+	void HandleSelectMaxFps(StringHash eventType, VariantMap& eventData);
+	void HandleSelectMaxInactiveFps(StringHash eventType, VariantMap& eventData);
+	void HandleSelectPerfOverlay(StringHash eventType, VariantMap& eventData);
+	void HandleSelectThreads(StringHash eventType, VariantMap& eventData);
+	void HandleDisplayModesReady(StringHash eventType, VariantMap& eventData);
 
 	void HandleBackButtonClick(StringHash eventType, VariantMap& eventData);
 	void HandleApplyButtonClick(StringHash eventType, VariantMap& eventData);
+	void HandleKeepModeClick(StringHash eventType, VariantMap& eventData);
+	void HandleRevertModeClick(StringHash eventType, VariantMap& eventData);
+	void HandleDisplaySwitchReverted(StringHash eventType, VariantMap& eventData);
+	void HandleUpdate(StringHash eventType, VariantMap& eventData);
+	void HandleChangeLanguage(StringHash eventType, VariantMap& eventData);
 };
@@ -0,0 +1,241 @@
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/UI/Text.h>
+
+#include "config.h"
+
+#include "mainMenu/perfOverlayState.h"
+#include "trace.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+using namespace Urho3D;
+
+const char* const PerfOverlayState::PRELOAD_MANIFEST[] =
+{
+	"UI/DefaultStyle.xml",
+};
+
+/// String::AppendWithFormat knows no precision, the overlay needs it for its columns.
+static String Format(const char* format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	return String(buffer);
+}
+
+PerfOverlayState::PerfOverlayState(Urho3D::Context * context)
+	: IGameState(context)
+{
+	PreloadUIResources(GetSubsystem<ResourceCache>(), PRELOAD_MANIFEST);
+
+	Configuration* config = GetSubsystem<Configuration>();
+	if (!config)
+		return;
+
+	config->SubscribeToChanges(this, Configuration::ParameterBit(Configuration::ConfigParameter::PerfOverlay), 0,
+		URHO3D_HANDLER(PerfOverlayState, HandleConfigChanged));
+
+	SetShown(config->Get(ConfigKeys::PerfOverlay));
+}
+
+void PerfOverlayState::Create()
+{
+	TRACE_ZONE(PerfOverlayCreate);
+
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	uiStateRoot_->SetDefaultStyle(cache->GetResource<XMLFile>("UI/DefaultStyle.xml"));
+
+	// above the UI of the state underneath
+	uiStateRoot_->SetPriority(100);
+	uiStateRoot_->SetAlignment(HA_RIGHT, VA_TOP);
+	uiStateRoot_->SetLayout(LM_VERTICAL, 2);
+
+	for (U32 line = 0; line < static_cast<U32>(Line::Count); line++)
+	{
+		lines_[line] = uiStateRoot_->CreateChild<Text>();
+		lines_[line]->SetStyleAuto();
+	}
+
+	sortedFrameTimes_.Reserve(FRAME_HISTORY);
+}
+
+void PerfOverlayState::Enter()
+{
+	TRACE_ZONE(PerfOverlayEnter);
+
+	frameIndex_ = 0;
+	frameCount_ = 0;
+	ResetZones();
+	frameTimer_.Reset();
+	refreshTimer_.Reset();
+
+	uiStateRoot_->SetVisible(true);
+
+	SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(PerfOverlayState, HandleBeginFrame));
+}
+
+void PerfOverlayState::Exit()
+{
+	TRACE_ZONE(PerfOverlayExit);
+
+	uiStateRoot_->SetVisible(false);
+
+	// the configuration subscription stays, it brings the overlay back
+	UnsubscribeFromEvent(E_BEGINFRAME);
+}
+
+void PerfOverlayState::Pause()
+{
+}
+
+void PerfOverlayState::Resume()
+{
+}
+
+void PerfOverlayState::SetShown(bool show)
+{
+	if (show == shown_)
+		return;
+
+	shown_ = show;
+
+	if (!show)
+	{
+		Exit();
+		return;
+	}
+
+	if (!created_)
+	{
+		Create();
+		created_ = true;
+	}
+
+	Enter();
+}
+
+void PerfOverlayState::HandleConfigChanged(StringHash eventType, VariantMap & eventData)
+{
+	SetShown(GetSubsystem<Configuration>()->Get(ConfigKeys::PerfOverlay));
+}
+
+void PerfOverlayState::HandleBeginFrame(StringHash eventType, VariantMap & eventData)
+{
+	frameTimes_[frameIndex_] = frameTimer_.GetUSec(true) / 1000.0f;
+	frameIndex_ = (frameIndex_ + 1) % FRAME_HISTORY;
+	frameCount_ = Min(frameCount_ + 1, FRAME_HISTORY);
+
+	// blocks hold the frame that just ended until the next EndFrame
+	Profiler* profiler = GetSubsystem<Profiler>();
+	if (profiler)
+	{
+		AccumulateZones(profiler->GetRootBlock(), 0);
+		zoneFrames_++;
+	}
+
+	if (refreshTimer_.GetMSec(false) >= REFRESH_MSEC)
+	{
+		refreshTimer_.Reset();
+		UpdateTexts();
+	}
+}
+
+void PerfOverlayState::UpdateTexts()
+{
+	if (!frameCount_)
+		return;
+
+	sortedFrameTimes_.Resize(frameCount_);
+	F32 totalTime = 0.0f;
+	for (U32 i = 0; i < frameCount_; i++)
+	{
+		sortedFrameTimes_[i] = frameTimes_[i];
+		totalTime += frameTimes_[i];
+	}
+
+	Sort(sortedFrameTimes_.Begin(), sortedFrameTimes_.End());
+
+	F32 averageTime = totalTime / frameCount_;
+	SetLine(Line::FrameRate, Format("FPS %.0f  avg %.2f ms", averageTime > 0.0f ? 1000.0f / averageTime : 0.0f, averageTime));
+	SetLine(Line::FrameTimes, Format("p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms",
+		sortedFrameTimes_[frameCount_ * 50 / 100],
+		sortedFrameTimes_[frameCount_ * 95 / 100],
+		sortedFrameTimes_[frameCount_ * 99 / 100],
+		sortedFrameTimes_[frameCount_ - 1]));
+
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	SetLine(Line::Memory, Format("Resources %.1f MB", cache->GetTotalMemoryUse() / (1024.0f * 1024.0f)));
+
+	Profiler* profiler = GetSubsystem<Profiler>();
+	if (profiler && zoneFrames_)
+	{
+		zonesText_.Clear();
+		FormatZones(profiler->GetRootBlock(), 0);
+		SetLine(Line::Profiler, zonesText_);
+		ResetZones();
+	}
+	else if (!profiler)
+	{
+		SetLine(Line::Profiler, "Profiler disabled");
+	}
+}
+
+void PerfOverlayState::AccumulateZones(const ProfilerBlock* block, U32 depth)
+{
+	if (depth >= PROFILER_DEPTH)
+		return;
+
+	for (const ProfilerBlock* child : block->children_)
+	{
+		ZoneTime& zone = zoneTimes_[child];
+		zone.time_ += child->frameTime_;
+		zone.maxTime_ = Max(zone.maxTime_, child->frameMaxTime_);
+
+		AccumulateZones(child, depth + 1);
+	}
+}
+
+void PerfOverlayState::FormatZones(const ProfilerBlock* block, U32 depth)
+{
+	if (depth >= PROFILER_DEPTH)
+		return;
+
+	for (const ProfilerBlock* child : block->children_)
+	{
+		ZoneTime zone;
+		if (!zoneTimes_.TryGetValue(child, zone) || !zone.time_)
+			continue;
+
+		// per frame average and the longest single call, in milliseconds
+		zonesText_ += Format("%*s%s  %.2f  max %.2f\n", static_cast<int>(depth * 2), "", child->name_,
+			zone.time_ / (1000.0f * zoneFrames_), zone.maxTime_ / 1000.0f);
+
+		FormatZones(child, depth + 1);
+	}
+}
+
+void PerfOverlayState::ResetZones()
+{
+	// entries are kept, blocks live as long as the profiler
+	for (auto& zone : zoneTimes_)
+		zone.second_ = ZoneTime();
+
+	zoneFrames_ = 0;
+}
+
+void PerfOverlayState::SetLine(Line line, const String& text)
+{
+	U32 index = static_cast<U32>(line);
+	if (lineTexts_[index] == text)
+		return;
+
+	lineTexts_[index] = text;
+	lines_[index]->SetText(text);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Core/Timer.h>
+
+#include "stateManager/gameStates.h"
+#include "utility/simpleTypes.h"
+
+#include "uiPreload.h"
+
+namespace Urho3D
+{
+	class ProfilerBlock;
+	class Text;
+}
+
+/**
+ * Performance HUD drawn above whatever state is active. It is not switched to through
+ * G_STATE_CHANGE, the "perfOverlay" configuration key enters and exits it.
+ */
+class PerfOverlayState : public IGameState
+{
+	URHO3D_OBJECT(PerfOverlayState, IGameState);
+
+public:
+
+	PerfOverlayState(Urho3D::Context * context);
+	virtual ~PerfOverlayState() = default;
+
+	virtual void Create();
+	virtual void Enter();
+	virtual void Exit();
+	virtual void Pause();
+	virtual void Resume();
+
+	/// Frames kept for the frame time percentiles.
+	static const U32 FRAME_HISTORY = 240;
+	/// Texts are rebuilt at most this often.
+	static const U32 REFRESH_MSEC = 500;
+	/// Profiler levels shown, counted from the frame block.
+	static const U32 PROFILER_DEPTH = 3;
+
+private:
+	enum class Line
+	{
+		FrameRate = 0,
+		FrameTimes,
+		Memory,
+		Profiler,
+		Count
+	};
+
+	static const char* const PRELOAD_MANIFEST[];
+
+	void SetShown(bool show);
+	void UpdateTexts();
+	/// Set the text of a line only when it differs from what is shown.
+	void SetLine(Line line, const String& text);
+
+	/// Add the last frame's block times to zoneTimes_.
+	void AccumulateZones(const ProfilerBlock* block, U32 depth);
+	void FormatZones(const ProfilerBlock* block, U32 depth);
+	void ResetZones();
+
+	void HandleConfigChanged(StringHash eventType, VariantMap& eventData);
+	void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+
+	bool created_ = false;
+	bool shown_   = false;
+
+	/// ring buffer of frame times in milliseconds
+	F32 frameTimes_[FRAME_HISTORY] = {};
+	U32 frameIndex_ = 0;
+	U32 frameCount_ = 0;
+	PODVector<F32> sortedFrameTimes_;
+
+	HiresTimer frameTimer_;
+	Timer      refreshTimer_;
+
+	/// Profiler block times since the last refresh. The overlay keeps its own interval, so
+	/// Profiler::BeginInterval() stays with the debug HUD.
+	struct ZoneTime
+	{
+		long long time_    = 0;
+		long long maxTime_ = 0;
+	};
+
+	HashMap<const ProfilerBlock*, ZoneTime> zoneTimes_;
+	U32    zoneFrames_ = 0;
+	String zonesText_;
+
+	WeakPtr<Text> lines_[static_cast<U32>(Line::Count)];
+	String        lineTexts_[static_cast<U32>(Line::Count)];
+};
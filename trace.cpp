@@ -0,0 +1,100 @@
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+
+#include "trace.h"
+
+#include <cstdio>
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* name_;
+		long long   start_;
+		long long   duration_;
+		ThreadID    thread_;
+	};
+
+	Mutex traceMutex;
+	PODVector<TraceEvent> traceEvents;
+}
+
+std::atomic<bool> Tracer::enabled_(true);
+
+void Tracer::Enable(bool enable)
+{
+	enabled_.store(enable, std::memory_order_relaxed);
+
+	if (!enable)
+	{
+		MutexLock lock(traceMutex);
+		traceEvents.Clear();
+	}
+}
+
+long long Tracer::GetUSec()
+{
+	// started by the first zone, after Time has set up the high resolution clock
+	static HiresTimer clock;
+	return clock.GetUSec(false);
+}
+
+void Tracer::AddZone(const char* name, long long startUSec, long long durationUSec)
+{
+	TraceEvent traceEvent;
+	traceEvent.name_ = name;
+	traceEvent.start_ = startUSec;
+	traceEvent.duration_ = durationUSec;
+	traceEvent.thread_ = Thread::GetCurrentThreadID();
+
+	MutexLock lock(traceMutex);
+	if (traceEvents.Size() < MAX_ZONES)
+		traceEvents.Push(traceEvent);
+}
+
+bool Tracer::Write(Context* context, const String& fileName)
+{
+	PODVector<TraceEvent> events;
+	{
+		MutexLock lock(traceMutex);
+		events = traceEvents;
+	}
+
+	// small thread numbers read better in the viewer than native ids
+	PODVector<ThreadID> threads;
+
+	String json;
+	json.Reserve(events.Size() * 96 + 64);
+	json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	char buffer[256];
+	for (U32 i = 0; i < events.Size(); i++)
+	{
+		const TraceEvent& traceEvent = events[i];
+
+		U32 thread = 0;
+		while (thread < threads.Size() && threads[thread] != traceEvent.thread_)
+			thread++;
+		if (thread == threads.Size())
+			threads.Push(traceEvent.thread_);
+
+		int length = std::snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u}",
+			i ? "," : "", traceEvent.name_, traceEvent.start_, traceEvent.duration_, thread);
+		json.Append(buffer, Min(static_cast<U32>(length), static_cast<U32>(sizeof(buffer) - 1)));
+	}
+
+	json += "]}\n";
+
+	File file(context, fileName, FILE_WRITE);
+	if (!file.IsOpen() || file.Write(json.CString(), json.Length()) != json.Length())
+	{
+		URHO3D_LOGERROR("Failed to write trace " + fileName);
+		return false;
+	}
+
+	URHO3D_LOGINFOF("Wrote %u trace zones to %s", events.Size(), fileName.CString());
+	return true;
+}
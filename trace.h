@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Container/Str.h>
+
+#include "utility/simpleTypes.h"
+
+#include <atomic>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+	class Context;
+}
+
+/**
+ * Zones of startup and state transitions, written as Chrome trace_event JSON (chrome://tracing,
+ * Perfetto). Recording is on from the start until Configuration::Load applies the "trace" key,
+ * so the startup is covered when it is set. While off a zone costs one relaxed load.
+ */
+class Tracer
+{
+public:
+	static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+	/// Disabling drops the recorded zones.
+	static void Enable(bool enable);
+
+	/// Microseconds since the first zone.
+	static long long GetUSec();
+	/// name must outlive the tracer, zones pass string literals. Safe to call from any thread.
+	static void AddZone(const char* name, long long startUSec, long long durationUSec);
+
+	static bool Write(Context* context, const String& fileName);
+
+	/// Recording stops at this many zones.
+	static const U32 MAX_ZONES = 1 << 18;
+
+private:
+	static std::atomic<bool> enabled_;
+};
+
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name)
+		: name_(name)
+		, start_(Tracer::IsEnabled() ? Tracer::GetUSec() : -1)
+	{
+	}
+
+	~TraceZone()
+	{
+		if (start_ >= 0)
+			Tracer::AddZone(name_, start_, Tracer::GetUSec() - start_);
+	}
+
+private:
+	const char* name_;
+	long long start_;
+};
+
+/// Trace zone without a profiler block, for worker threads and static functions.
+#define TRACE_SCOPE(name) TraceZone traceZone_##name(#name)
+/// Trace zone that is also a Urho3D profiler block, for Object members on the main thread.
+#define TRACE_ZONE(name) URHO3D_PROFILE(name); TRACE_SCOPE(name)
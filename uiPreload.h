@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+
+#include "utility/simpleTypes.h"
+
+using namespace Urho3D;
+
+/// Queue UI resources of a state for background loading, GetResource then waits only for those still loading.
+template <U32 N>
+inline void PreloadUIResources(ResourceCache* cache, const char* const (&manifest)[N])
+{
+	for (const char* resourceName : manifest)
+		cache->BackgroundLoadResource<XMLFile>(resourceName);
+}
+
+/// Time from the start of Create to the end of the first Enter of a state.
+class TimeToInteractive
+{
+public:
+	void Start()
+	{
+		timer_.Reset();
+		pending_ = true;
+	}
+
+	void Report(const char* stateName)
+	{
+		if (!pending_)
+			return;
+
+		pending_ = false;
+		URHO3D_LOGINFOF("%s interactive after %f ms", stateName, timer_.GetUSec(false) / 1000.0f);
+	}
+
+private:
+	HiresTimer timer_;
+	bool pending_ = false;
+};